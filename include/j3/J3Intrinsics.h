@@ -67,16 +67,25 @@ public:
   llvm::Function* ResolveSpecialStubFunction;
   llvm::Function* ResolveStaticStubFunction;
   llvm::Function* ResolveInterfaceFunction;
+  llvm::Function* InlineCacheMissFunction;
+  llvm::Function* CompileOSRFunction;
 
   llvm::Function* VirtualLookupFunction;
   llvm::Function* IsSubclassOfFunction;
   llvm::Function* IsSecondaryClassFunction;
+  llvm::Function* IsSecondaryTypeFunction;
   llvm::Function* GetDepthFunction;
   llvm::Function* GetDisplayFunction;
   llvm::Function* GetVTInDisplayFunction;
   llvm::Function* GetStaticInstanceFunction;
   llvm::Function* AquireObjectFunction;
   llvm::Function* ReleaseObjectFunction;
+  llvm::Function* ArrayFillFunction;
+  llvm::Function* ArrayEqualsFunction;
+  llvm::Function* StringEqualsFunction;
+  llvm::Function* StringHashCodeFunction;
+  llvm::Function* StringIndexOfFunction;
+  llvm::Function* NanoTimeFunction;
   llvm::Function* GetConstantPoolAtFunction;
   llvm::Function* MultiCallNewFunction;
   llvm::Function* GetArrayClassFunction;
@@ -85,6 +94,7 @@ public:
   llvm::Function* RuntimeDelegateeFunction;
   llvm::Function* ArrayLengthFunction;
   llvm::Function* GetVTFunction;
+  llvm::Function* NullCheckFunction;
   llvm::Function* GetIMTFunction;
   llvm::Function* GetClassFunction;
   llvm::Function* GetVTFromClassFunction;
@@ -116,6 +126,7 @@ public:
   llvm::Constant* OffsetStaticInstanceInTaskClassMirrorConstant;
   llvm::Constant* OffsetInitializedInTaskClassMirrorConstant;
   llvm::Constant* OffsetStatusInTaskClassMirrorConstant;
+  llvm::Constant* OffsetBiasRevocationsInClassConstant;
   
   llvm::Constant* OffsetDoYieldInThreadConstant;
   llvm::Constant* OffsetIsolateIDInThreadConstant;
@@ -10,6 +10,9 @@
 #ifndef J3_AOT_COMPILER_H
 #define J3_AOT_COMPILER_H
 
+#include <set>
+#include <string>
+
 #include "vmkit/VmkitDenseMap.h"
 #include "vmkit/UTF8.h"
 #include "j3/JavaLLVMCompiler.h"
@@ -84,6 +87,9 @@ private:
 
   //--------------- Static compiler specific functions -----------------------//
   llvm::Constant* CreateConstantFromVT(JavaVirtualTable* VT);
+  llvm::Constant* CreateConstantFromIMTConflicts(Class* cl,
+                                                 std::set<JavaMethod*>& atIndex,
+                                                 llvm::PointerType* PTy);
   llvm::Constant* CreateConstantFromUTF8(const UTF8* val);
   llvm::Constant* CreateConstantFromCommonClass(CommonClass* cl);
   llvm::Constant* CreateConstantFromClass(Class* cl);
@@ -167,6 +173,20 @@ private:
 
   bool isCompiling(const CommonClass* cl) const;
 
+  /// hotMethods - Methods listed in the profile, keyed on
+  /// "class.name(signature)".
+  ///
+  std::set<std::string> hotMethods;
+
+  /// hasProfile - True if a profile has been read.
+  ///
+  bool hasProfile;
+
+  /// applyProfile - Hint the LLVM inliner for hot methods and optimize the
+  /// other ones for size.
+  ///
+  void applyProfile(JavaMethod* meth, llvm::Function* func);
+
 public:
   llvm::Function* StaticInitializer;
   llvm::Function* ObjectPrinter;
@@ -192,6 +212,23 @@ public:
   
   void printStats();
   
+  /// readProfile - Read the compiled methods recorded by a run with
+  /// -Xrecord-startup. Returns false if the file can not be read.
+  ///
+  bool readProfile(const char* fileName);
+
+  /// isHot - Is the method part of the profile? Without a profile, all
+  /// methods are hot.
+  ///
+  bool isHot(JavaMethod* meth);
+
+  /// splitModule - Split the generated module into nbParts modules that can
+  /// be compiled in parallel. Methods are partitioned by package; all global
+  /// variables and stubs are defined in the first part. Each part gets its
+  /// own module identifier, hence its own frametable.
+  ///
+  void splitModule(uint32 nbParts, std::vector<llvm::Module*>& parts);
+
   void compileFile(Jnjvm* vm, const char* name);
   void compileClass(Class* cl);
   void compileClassLoader(JnjvmBootstrapLoader* loader);
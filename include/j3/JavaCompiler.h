@@ -46,6 +46,14 @@ public:
     return 0;
   }
 
+  /// compileOSR - Compile a version of the method that is entered at the
+  /// loop header of the given bytecode index, with the locals of a running
+  /// frame of the method. Returns null if the compiler can not replace
+  /// frames on stack.
+  virtual void* compileOSR(JavaMethod* meth, uint32_t index) {
+    return 0;
+  }
+
   virtual bool isStaticCompiling() {
     return false;
   }
@@ -15,6 +15,8 @@
 #include "llvm/ExecutionEngine/JITEventListener.h"
 #include "j3/JavaLLVMCompiler.h"
 
+#include <set>
+
 namespace j3 {
 
 class JavaJITCompiler;
@@ -56,8 +58,14 @@ public:
 
   virtual void makeVT(Class* cl);
   virtual void makeIMT(Class* cl);
+
+  /// makeIMTConflictTable - Build the perfect hash table of an IMT slot
+  /// shared by methods with different targets.
+  ///
+  word_t* makeIMTConflictTable(Class* cl, std::set<JavaMethod*>& atIndex);
   
   virtual void* materializeFunction(JavaMethod* meth, Class* customizeFor);
+  virtual void* compileOSR(JavaMethod* meth, uint32_t index);
   
   virtual llvm::Constant* getFinalObject(JavaObject* obj, CommonClass* cl);
   virtual JavaObject* getFinalObject(llvm::Value* C);
@@ -208,8 +208,14 @@ public:
   virtual void* materializeFunction(JavaMethod* meth,
                                     Class* customizeFor) = 0;
   llvm::Function* parseFunction(JavaMethod* meth, Class* customizeFor);
+
+  /// parseOSRFunction - Create and compile the version of the method
+  /// entered at the given loop header. Its only argument is the buffer
+  /// holding the locals of the replaced frame.
+  llvm::Function* parseOSRFunction(JavaMethod* meth, uint16 index);
    
   llvm::FunctionPassManager* JavaFunctionPasses;
+  llvm::FunctionPassManager* JavaLoopPasses;
   llvm::FunctionPassManager* J3FunctionPasses;
   llvm::FunctionPassManager* JavaNativeFunctionPasses;
   
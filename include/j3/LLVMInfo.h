@@ -24,6 +24,7 @@ namespace llvm {
 namespace j3 {
 
 class Class;
+class InlineCache;
 class JavaField;
 class JavaLLVMCompiler;
 class JavaMethod;
@@ -92,6 +93,19 @@ public:
   llvm::Constant* getOffset();
   llvm::FunctionType* getFunctionType();
   bool isCustomizable;
+
+  /// inlineCaches - The inline caches of the call sites of this method,
+  /// by bytecode index. They outlive a compilation so that later versions
+  /// of the method (e.g. customized ones) can use their profile.
+  std::map<uint16, InlineCache*> inlineCaches;
+
+  /// typeCheckMisses - The number of times the type checks of this method
+  /// went out of line, by bytecode index.
+  std::map<uint16, word_t*> typeCheckMisses;
+
+  /// osrEntries - The code of the versions of this method entered at a loop
+  /// header, by bytecode index.
+  std::map<uint16, void*> osrEntries;
     
   LLVMMethodInfo(JavaMethod* M, JavaLLVMCompiler* comp) :  Compiler(comp),
     methodDef(M), methodFunction(0), offsetConstant(0), functionType(0),
@@ -32,11 +32,25 @@ protected:
 
   // initiator - The initiator of the rendesvous.
   Thread* initiator;
+
+  /// nbCritical - Number of GC critical sections entered and not exited yet.
+  /// No collection starts while it is not zero.
+  unsigned nbCritical;
+
+  /// condCritical - Condition for unblocking the threads waiting for the
+  /// critical sections to end before collecting.
+  Cond condCritical;
+
+  /// collecting - Is the current rendezvous a collection? Other rendezvous
+  /// only stop the threads at a safe point, e.g. to revoke a bias.
+  bool collecting;
   
 public: 
   CollectionRV() {
     nbJoined = 0;
     initiator = NULL;
+    nbCritical = 0;
+    collecting = false;
   }
 
   void lockRV() { _lockRV.lock(); }
@@ -56,8 +70,36 @@ public:
   }
   
   void another_mark();
+
+  /// enterCritical - Enter a GC critical section: objects do not move until
+  /// the matching exitCritical. Joins the collection going on, if any. Must
+  /// be called in cooperative code. The thread must not allocate nor block
+  /// on another thread before exiting the section.
+  ///
+  void enterCritical();
+
+  /// exitCritical - Exit a GC critical section, letting the collections
+  /// wait for the other sections to end.
+  ///
+  void exitCritical();
+
+  /// waitCriticalSections - Wait until no thread is in a GC critical section.
+  /// Called with the lock held, before initiating a collection. Returns
+  /// false if the thread joined the collection of another thread instead.
+  ///
+  bool waitCriticalSections();
   Thread* getInitiator() const { return initiator; }
 
+  /// markCollection - Tell the threads that the rendezvous about to start is
+  /// a collection. Called with the lock held, before synchronize.
+  ///
+  void markCollection() { collecting = true; }
+
+  /// isCollecting - Is the rendezvous going on a collection? Called with the
+  /// lock held.
+  ///
+  bool isCollecting() const { return collecting; }
+
   virtual void finishRV() = 0;
   virtual void synchronize() = 0;
 
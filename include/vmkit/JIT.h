@@ -189,6 +189,9 @@ public:
 
    static void addCommandLinePasses(llvm::FunctionPassManager* PM);
 
+   /// isOptimizing - Are optimization passes run on the compiled code?
+   static bool isOptimizing();
+
    static const char* getHostTriple();
 };
 
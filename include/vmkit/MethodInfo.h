@@ -56,12 +56,40 @@ public:
   }
 };
 
+/// CompiledFrames - A frametable emitted by the AOT GC printer. FrameInfos is
+/// sorted by return address when the table is registered, and searched in
+/// place.
+///
 class CompiledFrames {
 public:
   uint32_t NumCompiledFrames;
+  uint32_t NumFrameInfos;
+  FrameInfo** FrameInfos;
   Frames* frames() const {
     return reinterpret_cast<Frames*>(
-        reinterpret_cast<word_t>(this) + kWordSize);
+        reinterpret_cast<word_t>(this) + sizeof(CompiledFrames));
+  }
+
+  /// lookup - Find the FrameInfo of the given return address, or null.
+  ///
+  FrameInfo* lookup(word_t ip) const {
+    if (NumFrameInfos == 0) return NULL;
+    if (ip < FrameInfos[0]->ReturnAddress) return NULL;
+    if (ip > FrameInfos[NumFrameInfos - 1]->ReturnAddress) return NULL;
+    uint32_t low = 0;
+    uint32_t high = NumFrameInfos;
+    while (low < high) {
+      uint32_t middle = low + (high - low) / 2;
+      if (FrameInfos[middle]->ReturnAddress < ip) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    if (low < NumFrameInfos && FrameInfos[low]->ReturnAddress == ip) {
+      return FrameInfos[low];
+    }
+    return NULL;
   }
 };
 
@@ -161,16 +161,43 @@ public:
   //    ^      ^^^ ^^^^ ^^^^        ^^^^ ^^^^ ^^^^        ^^^^ ^^^^
   //    1           11                    12                  8
   // fat lock    thread id       thin lock count + hash     GC bits
+  //
+  // On 64-bit platforms, the two upper bits of the header are used for biased
+  // locking. A biased header holds the id of the thread the object is biased
+  // towards and the number of times that thread holds the lock. Only the
+  // owner of the bias writes the header, without atomic operations. Another
+  // thread revokes the bias while the owner is stopped at a safe point, and
+  // marks the object unbiasable so that it is never biased again.
 
   static const uint64_t FatMask = 1LL << (kThreadStart > 0xFFFFFFFFLL ? 61LL : 31LL);
 
+  static const uint64_t BiasedMask = kThreadStart > 0xFFFFFFFFLL ? 1ULL << 62 : 0;
+  static const uint64_t UnbiasableMask = kThreadStart > 0xFFFFFFFFLL ? 1ULL << 63 : 0;
+
   static const uint64_t NonLockBits = HashBits + GCBits;
-  static const uint64_t NonLockBitsMask = ((1LL << NonLockBits) - 1LL);
+  static const uint64_t NonLockBitsMask = ((1LL << NonLockBits) - 1LL) | UnbiasableMask;
 
   static const uint64_t ThinCountMask = 0xFFFFFFFFLL & ~(FatMask | kThreadIDMask | NonLockBitsMask);
   static const uint64_t ThinCountShift = NonLockBits;
   static const uint64_t ThinCountAdd = 1LL << NonLockBits;
 
+  static const uint64_t ThreadIDMask = kThreadIDMask & ~(BiasedMask | UnbiasableMask);
+
+  /// supportsBiasing - Returns true if objects can be biased. Biasing is
+  /// disabled when the collector sets header bits with atomic operations
+  /// in its barriers, as the owner of a bias writes the header with plain
+  /// stores.
+  static bool supportsBiasing();
+
+  /// revokeBias - Turn the bias of the object, if any, into a thin lock
+  /// held as many times by the owner of the bias. Called by another thread
+  /// than the owner, the owner is first stopped at a safe point.
+  static void revokeBias(gc* object);
+
+  /// biasedToOtherThread - Returns true if the header is biased towards
+  /// another thread than the current one.
+  static bool biasedToOtherThread(word_t header);
+
   /// initialise - Initialise the value of the lock.
   ///
   static void removeFatLock(FatLock* fatLock, LockSystem& table);
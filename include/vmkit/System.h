@@ -15,6 +15,7 @@
 #include <dlfcn.h>
 #include <signal.h>
 #include <stdint.h>
+#include <time.h>
 #include <unistd.h>
 
 
@@ -71,6 +72,10 @@ const word_t kThreadIDMask  = 0x7FF00000;
 const word_t kVmkitThreadMask = 0xF0000000;
 #endif
 
+#if MACOS_OS
+  #include <mach/mach_time.h>
+#endif
+
 #if MACOS_OS
   #define LONGJMP _longjmp
   #define SETJMP _setjmp
@@ -229,6 +234,20 @@ public:
 #endif
   }
 
+  /// GetNanoTime - Read a monotonic clock, in nanoseconds. On Linux,
+  /// clock_gettime reads the clock through the vDSO, without a system call.
+  static int64_t GetNanoTime() {
+#if MACOS_OS
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) mach_timebase_info(&timebase);
+    return (int64_t)(mach_absolute_time() * timebase.numer / timebase.denom);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+  }
+
   static int GetNumberOfProcessors() {
     return sysconf(_SC_NPROCESSORS_ONLN);
   }
@@ -245,7 +245,8 @@ public:
   void* operator new(size_t sz);
   void operator delete(void* th) { UNREACHABLE(); }
   
-  /// releaseThread - Free the stack so that another thread can use it.
+  /// releaseThread - Free the stack so that another thread can use it. The
+  /// stack is cached if its system thread waits for a new thread.
   ///
   static void releaseThread(vmkit::Thread* th);
 
@@ -30,10 +30,15 @@ class FunctionMap {
 public:
   /// Functions - Map of applicative methods to function pointers. This map is
   /// used when walking the stack so that VMKit knows which applicative method
-  /// is executing on the stack.
+  /// is executing on the stack. Only holds JIT-compiled frames.
   ///
   llvm::DenseMap<word_t, FrameInfo*> Functions;
 
+  /// AOTFrames - Null-terminated list of the frametables of AOT-compiled
+  /// code. They are searched in place and never copied into Functions.
+  ///
+  CompiledFrames** AOTFrames;
+
   /// FunctionMapLock - Spin lock to protect the Functions map.
   ///
   vmkit::SpinLock FunctionMapLock;
@@ -199,6 +204,12 @@ public:
   ///
   virtual const char* getObjectTypeName(gc* object) { return "An object"; }
 
+  /// biasRevoked - Called when a thread revoked the bias of this object
+  /// towards another thread. Lets the virtual machine stop biasing the types
+  /// whose biases are often revoked.
+  ///
+  virtual void biasRevoked(gc* object) {}
+
   /// rendezvous - The rendezvous implementation for garbage collection.
   ///
   CooperativeCollectionRV rendezvous;
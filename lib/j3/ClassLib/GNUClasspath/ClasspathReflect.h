@@ -197,6 +197,15 @@ public:
 
     self->stackTrace = NULL;
   }
+
+  /// clearStackTrace - Remove the stack trace of the throwable. Its stack
+  /// trace is then empty.
+  ///
+  static void clearStackTrace(JavaObjectThrowable* self) {
+    llvm_gcroot(self, 0);
+    self->vmState = NULL;
+    self->stackTrace = NULL;
+  }
 };
 
 class JavaObjectReference : public JavaObject {
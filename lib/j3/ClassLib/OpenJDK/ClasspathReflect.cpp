@@ -7,6 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <map>
+
 #include "ClasspathReflect.h"
 #include "JavaArray.h"
 #include "JavaClass.h"
@@ -35,54 +37,77 @@ JavaMethod* JavaObjectMethod::getInternalMethod(JavaObjectMethod* self) {
 }
 
 
-int JavaObjectThrowable::getStackTraceBase(JavaObjectThrowable * self) {
-  JavaObject * stack = NULL;
+ArrayObject* JavaObjectThrowable::getStackTrace(JavaObjectThrowable* self) {
+  JavaObject* stack = NULL;
+  ArrayObject* result = NULL;
+  JavaObject* element = NULL;
   llvm_gcroot(self, 0);
   llvm_gcroot(stack, 0);
+  llvm_gcroot(result, 0);
+  llvm_gcroot(element, 0);
 
-  if (!self->backtrace) return 0;
+  if (!self->backtrace) return NULL;
 
   Jnjvm* vm = JavaThread::get()->getJVM();
 
   stack = self->backtrace;
-  sint32 index = 2;;
-  while (index != JavaArray::getSize(stack)) {
-    vmkit::FrameInfo* FI = vm->IPToFrameInfo(ArrayPtr::getElement((ArrayPtr*)stack, index));
-    if (FI->Metadata == NULL) ++index;
-    else {
+  if (JavaObject::getClass(stack) == vm->upcalls->stackTraceArray) {
+    return (ArrayObject*)stack;
+  }
+
+  // Decode the IPs once, skipping the fillInStackTrace method, the last
+  // method on the stack, the frames without Java metadata and the
+  // constructors of the throwable, up to the maximum depth.
+  sint32 length = JavaArray::getSize(stack);
+  vmkit::ThreadAllocator allocator;
+  vmkit::FrameInfo** frames = (vmkit::FrameInfo**)
+    allocator.Allocate(length * sizeof(vmkit::FrameInfo*));
+  intptr_t* ips = (intptr_t*)allocator.Allocate(length * sizeof(intptr_t));
+
+  sint32 size = 0;
+  bool inThrowable = true;
+  for (sint32 i = 2; i < length; ++i) {
+    if ((uint32)size == vm->maxStackTraceDepth) break;
+    intptr_t ip = ArrayPtr::getElement((ArrayPtr*)stack, i);
+    if (ip == 0) break;
+    vmkit::FrameInfo* FI = vm->IPToFrameInfo(ip);
+    if (FI->Metadata == NULL) continue;
+    if (inThrowable) {
       JavaMethod* meth = (JavaMethod*)FI->Metadata;
-      assert(meth && "Wrong stack trace");
-      if (meth->classDef->isSubclassOf(vm->upcalls->newThrowable)) {
-        ++index;
-      } else return index;
+      if (meth->classDef->isSubclassOf(vm->upcalls->newThrowable)) continue;
+      inThrowable = false;
+    }
+    frames[size] = FI;
+    ips[size] = ip;
+    ++size;
+  }
+
+  // Frames at the same call site, as in recursions, share their element.
+  std::map<vmkit::FrameInfo*, sint32> decoded;
+  result = (ArrayObject*)vm->upcalls->stackTraceArray->doNew(size, vm);
+  for (sint32 i = 0; i < size; ++i) {
+    std::map<vmkit::FrameInfo*, sint32>::iterator it = decoded.find(frames[i]);
+    if (it != decoded.end()) {
+      element = ArrayObject::getElement(result, it->second);
+    } else {
+      element = consStackElement(frames[i], ips[i]);
+      decoded[frames[i]] = i;
     }
+    ArrayObject::setElement(result, element, i);
   }
 
-  assert(0 && "Invalid stack trace!");
-  return 0;
+  vmkit::Collector::objectReferenceWriteBarrier(
+      (gc*)self, (gc**)&(self->backtrace), (gc*)result);
+  return result;
 }
 
 int JavaObjectThrowable::getStackTraceDepth(JavaObjectThrowable * self) {
-  JavaObject * stack = NULL;
+  ArrayObject* stack = NULL;
   llvm_gcroot(self, 0);
   llvm_gcroot(stack, 0);
 
-  if (!self->backtrace) return 0;
-
-  Jnjvm* vm = JavaThread::get()->getJVM();
-
-  stack = self->backtrace;
-  sint32 index = getStackTraceBase(self);
-
-  sint32 size = 0;
-  sint32 cur = index;
-  while (cur < JavaArray::getSize(stack)) {
-    vmkit::FrameInfo* FI = vm->IPToFrameInfo(ArrayPtr::getElement((ArrayPtr*)stack, cur));
-    ++cur;
-    if (FI->Metadata != NULL) ++size;
-  }
-
-  return size;
+  stack = getStackTrace(self);
+  return stack ? ArrayObject::getSize(stack) : 0;
 }
 
 JavaObjectConstructor* JavaObjectConstructor::createFromInternalConstructor(JavaMethod * cons, int i) {
@@ -21,6 +21,7 @@
 #include "JavaUpcalls.h"
 
 extern "C" j3::JavaObject* internalFillInStackTrace(j3::JavaObject*);
+j3::JavaObject* consStackElement(vmkit::FrameInfo* FI, intptr_t ip);
 namespace j3 {
 
 class JavaObjectClass : public JavaObject {
@@ -300,8 +301,22 @@ public:
     self->stackTrace = NULL;
   }
 
+  /// clearStackTrace - Remove the stack trace of the throwable. Its stack
+  /// trace is then empty.
+  ///
+  static void clearStackTrace(JavaObjectThrowable* self) {
+    llvm_gcroot(self, 0);
+    self->backtrace = NULL;
+    self->stackTrace = NULL;
+  }
+
+  /// getStackTrace - Get the stack trace elements of the throwable. The
+  /// captured IPs are decoded the first time and the elements replace them
+  /// in the backtrace field.
+  ///
+  static ArrayObject* getStackTrace(JavaObjectThrowable* self);
+
   static int getStackTraceDepth(JavaObjectThrowable * self);
-  static int getStackTraceBase(JavaObjectThrowable * self);
 };
 
 class JavaObjectReference : public JavaObject {
@@ -0,0 +1,284 @@
+//===-------- ElideLocks.cpp - Removes locks on thread-local objects ------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass removes the monitor enter and exit sequences on objects that are
+// allocated in the function and never escape it: no other thread can lock
+// them. An object escapes if it is stored to the heap, returned or passed to
+// a function, other than the lock slow paths and functions that only read
+// memory.
+//
+// The objects go through the allocas of the Java locals and stack slots,
+// which are GC roots and are not promoted to registers. A load from a slot
+// where the object was stored reads the object if the last store to the slot
+// in the block of the load stores the object, or, when there is no such
+// store, if the slot only ever holds the object or null.
+//
+// The compare and swaps of the monitor sequences are replaced by their
+// expected value and the slow paths are removed, so that the locked path is
+// always taken and the header of the object never changes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Constants.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/Compiler.h"
+
+#include <vector>
+
+#include "j3/JavaLLVMCompiler.h"
+#include "j3/J3Intrinsics.h"
+
+using namespace llvm;
+
+namespace j3 {
+
+class ElideLocks : public FunctionPass {
+public:
+  static char ID;
+  JavaLLVMCompiler* TheCompiler;
+  ElideLocks(JavaLLVMCompiler* Compiler) : FunctionPass(ID),
+    TheCompiler(Compiler) { }
+
+  const char* getPassName() const { return "Elide Java thread-local locks"; }
+
+  virtual bool runOnFunction(Function &F);
+
+private:
+  SmallPtrSet<Value*, 16> Aliases;
+  std::vector<AllocaInst*> Slots;
+  std::vector<Instruction*> Locks;
+
+  bool isThreadLocal(Instruction* Alloc);
+  bool addAlias(Value* V);
+  bool addSlot(AllocaInst* Slot);
+  bool isFieldAccess(Value* P, bool LockWord);
+  Value* getReachingStore(LoadInst* Load, AllocaInst* Slot);
+  bool onlyHoldsAliases(AllocaInst* Slot);
+  void elide();
+};
+char ElideLocks::ID = 0;
+
+// Uses of a pointer inside the object. Stores and compare and swaps on the
+// lock word are part of the monitor sequences.
+bool ElideLocks::isFieldAccess(Value* P, bool LockWord) {
+  for (Value::use_iterator I = P->use_begin(), E = P->use_end();
+       I != E; ++I) {
+    Instruction* II = dyn_cast<Instruction>(*I);
+    if (II == NULL) return false;
+    if (isa<BitCastInst>(II) || isa<GetElementPtrInst>(II)) {
+      if (II->getOperand(0) != P) return false;
+      if (!isFieldAccess(II, LockWord)) return false;
+    } else if (isa<LoadInst>(II)) {
+      continue;
+    } else if (StoreInst* SI = dyn_cast<StoreInst>(II)) {
+      if (SI->getValueOperand() == P) return false;
+      if (LockWord) Locks.push_back(SI);
+    } else if (AtomicCmpXchgInst* CX = dyn_cast<AtomicCmpXchgInst>(II)) {
+      if (!LockWord || CX->getPointerOperand() != P) return false;
+      Locks.push_back(CX);
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ElideLocks::addSlot(AllocaInst* Slot) {
+  J3Intrinsics* intrinsics = TheCompiler->getIntrinsics();
+  for (unsigned i = 0; i < Slots.size(); ++i) {
+    if (Slots[i] == Slot) return true;
+  }
+  for (Value::use_iterator I = Slot->use_begin(), E = Slot->use_end();
+       I != E; ++I) {
+    if (isa<LoadInst>(*I)) continue;
+    if (StoreInst* SI = dyn_cast<StoreInst>(*I)) {
+      if (SI->getPointerOperand() != Slot) return false;
+    } else if (BitCastInst* BI = dyn_cast<BitCastInst>(*I)) {
+      // The slot may be a GC root.
+      for (Value::use_iterator U = BI->use_begin(), UE = BI->use_end();
+           U != UE; ++U) {
+        CallInst* CI = dyn_cast<CallInst>(*U);
+        if (CI == NULL ||
+            CI->getCalledValue() != intrinsics->llvm_gc_gcroot) {
+          return false;
+        }
+      }
+    } else {
+      return false;
+    }
+  }
+  Slots.push_back(Slot);
+  return true;
+}
+
+bool ElideLocks::addAlias(Value* V) {
+  if (!Aliases.insert(V)) return true;
+  J3Intrinsics* intrinsics = TheCompiler->getIntrinsics();
+  for (Value::use_iterator I = V->use_begin(), E = V->use_end();
+       I != E; ++I) {
+    Instruction* II = dyn_cast<Instruction>(*I);
+    if (II == NULL) return false;
+    if (isa<BitCastInst>(II)) {
+      if (!addAlias(II)) return false;
+    } else if (GetElementPtrInst* GEP = dyn_cast<GetElementPtrInst>(II)) {
+      if (GEP->getPointerOperand() != V) return false;
+      bool LockWord = GEP->getNumIndices() == 2 &&
+        GEP->getOperand(2) == intrinsics->JavaObjectLockOffsetConstant;
+      if (!isFieldAccess(GEP, LockWord)) return false;
+    } else if (isa<LoadInst>(II) || isa<ICmpInst>(II)) {
+      continue;
+    } else if (StoreInst* SI = dyn_cast<StoreInst>(II)) {
+      if (SI->getValueOperand() != V) continue;
+      AllocaInst* Slot = dyn_cast<AllocaInst>(SI->getPointerOperand());
+      if (Slot == NULL || !addSlot(Slot)) return false;
+    } else if (isa<CallInst>(II) || isa<InvokeInst>(II)) {
+      CallSite Call(II);
+      Value* Callee = Call.getCalledValue();
+      if (Callee == intrinsics->AquireObjectFunction ||
+          Callee == intrinsics->ReleaseObjectFunction) {
+        Locks.push_back(II);
+      } else if (Callee == V || !Call.onlyReadsMemory()) {
+        return false;
+      } else if (II->getType()->isPointerTy()) {
+        // The function may return the object.
+        if (!addAlias(II)) return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Get the value of the last store to the slot before the load, in the block
+// of the load, or null if there is none.
+Value* ElideLocks::getReachingStore(LoadInst* Load, AllocaInst* Slot) {
+  BasicBlock::iterator I = Load;
+  BasicBlock::iterator B = Load->getParent()->begin();
+  while (I != B) {
+    --I;
+    StoreInst* SI = dyn_cast<StoreInst>(I);
+    if (SI != NULL && SI->getPointerOperand() == Slot) {
+      return SI->getValueOperand();
+    }
+  }
+  return NULL;
+}
+
+bool ElideLocks::onlyHoldsAliases(AllocaInst* Slot) {
+  for (Value::use_iterator I = Slot->use_begin(), E = Slot->use_end();
+       I != E; ++I) {
+    if (StoreInst* SI = dyn_cast<StoreInst>(*I)) {
+      Value* V = SI->getValueOperand();
+      if (!isa<ConstantPointerNull>(V) && !Aliases.count(V)) return false;
+    }
+  }
+  return true;
+}
+
+bool ElideLocks::isThreadLocal(Instruction* Alloc) {
+  Aliases.clear();
+  Slots.clear();
+  Locks.clear();
+  if (!addAlias(Alloc)) return false;
+
+  // Follow the object through the slots until no new load reads it.
+  bool Changed = true;
+  while (Changed) {
+    Changed = false;
+    for (unsigned i = 0; i < Slots.size(); ++i) {
+      AllocaInst* Slot = Slots[i];
+      for (Value::use_iterator I = Slot->use_begin(), E = Slot->use_end();
+           I != E; ++I) {
+        LoadInst* Load = dyn_cast<LoadInst>(*I);
+        if (Load == NULL || Aliases.count(Load)) continue;
+        Value* Stored = getReachingStore(Load, Slot);
+        if (Stored != NULL ? Aliases.count(Stored) : onlyHoldsAliases(Slot)) {
+          if (!addAlias(Load)) return false;
+          Changed = true;
+        }
+      }
+    }
+  }
+
+  // The other loads from the slots must not read the object.
+  for (unsigned i = 0; i < Slots.size(); ++i) {
+    AllocaInst* Slot = Slots[i];
+    for (Value::use_iterator I = Slot->use_begin(), E = Slot->use_end();
+         I != E; ++I) {
+      LoadInst* Load = dyn_cast<LoadInst>(*I);
+      if (Load == NULL || Aliases.count(Load)) continue;
+      if (getReachingStore(Load, Slot) == NULL) return false;
+    }
+  }
+  return true;
+}
+
+void ElideLocks::elide() {
+  LLVMContext& Context = Locks[0]->getContext();
+  for (std::vector<Instruction*>::iterator i = Locks.begin(),
+       e = Locks.end(); i != e; ++i) {
+    Instruction* I = *i;
+    if (AtomicCmpXchgInst* CX = dyn_cast<AtomicCmpXchgInst>(I)) {
+      // The compare and swap succeeds: fold the test of its result.
+      Value* Expected = CX->getCompareOperand();
+      while (!CX->use_empty()) {
+        ICmpInst* Cmp = dyn_cast<ICmpInst>(*CX->use_begin());
+        if (Cmp != NULL && Cmp->getPredicate() == ICmpInst::ICMP_EQ &&
+            (Cmp->getOperand(0) == Expected ||
+             Cmp->getOperand(1) == Expected)) {
+          Cmp->replaceAllUsesWith(ConstantInt::getTrue(Context));
+          Cmp->eraseFromParent();
+        } else {
+          CX->replaceAllUsesWith(Expected);
+        }
+      }
+    }
+    I->eraseFromParent();
+  }
+}
+
+bool ElideLocks::runOnFunction(Function& F) {
+  J3Intrinsics* intrinsics = TheCompiler->getIntrinsics();
+  std::vector<Instruction*> Allocs;
+  for (Function::iterator BI = F.begin(), BE = F.end(); BI != BE; BI++) {
+    for (BasicBlock::iterator II = BI->begin(), IE = BI->end(); II != IE;
+         II++) {
+      if (II->getOpcode() != Instruction::Call &&
+          II->getOpcode() != Instruction::Invoke) {
+        continue;
+      }
+      CallSite Call(II);
+      if (Call.getCalledValue() == intrinsics->AllocateFunction) {
+        Allocs.push_back(II);
+      }
+    }
+  }
+
+  bool Changed = false;
+  for (std::vector<Instruction*>::iterator i = Allocs.begin(),
+       e = Allocs.end(); i != e; ++i) {
+    if (isThreadLocal(*i) && !Locks.empty()) {
+      elide();
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+
+FunctionPass* createElideLocksPass(JavaLLVMCompiler* Compiler) {
+  return new ElideLocks(Compiler);
+}
+
+}
@@ -0,0 +1,239 @@
+//===---- EliminateRangeChecks.cpp - Removes array range checks in loops --===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This pass guards the array range checks of a loop whose index is the
+// induction variable of the loop. If, before entering the loop, the range of
+// the induction variable is known to be inside the array, the checks can not
+// fail. The pass computes that condition in the preheader and ORs it with the
+// range checks. The condition is loop invariant, so the loop unswitcher then
+// splits the loop into an unchecked version and the original, checked one.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/Constants.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Transforms/Scalar.h"
+
+#include <map>
+
+#include "JavaClass.h"
+#include "j3/JavaLLVMCompiler.h"
+#include "j3/J3Intrinsics.h"
+
+using namespace llvm;
+
+namespace j3 {
+
+class EliminateRangeChecks : public FunctionPass {
+public:
+  static char ID;
+  JavaLLVMCompiler* TheCompiler;
+  EliminateRangeChecks(JavaLLVMCompiler* Compiler) : FunctionPass(ID),
+    TheCompiler(Compiler) { }
+
+  const char* getPassName() const { return "Eliminate Java range checks"; }
+
+  virtual void getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequiredID(LoopSimplifyID);
+    AU.addRequired<LoopInfo>();
+    AU.addPreserved<LoopInfo>();
+  }
+
+  virtual bool runOnFunction(Function &F);
+
+private:
+  bool runOnLoop(Loop* L);
+  bool throwsIndexOutOfBounds(BasicBlock* BB);
+  Value* getSafeCondition(Instruction* InsertPt, Value* Start, Value* Bound,
+                          Value* Length, int64_t Offset);
+};
+char EliminateRangeChecks::ID = 0;
+
+bool EliminateRangeChecks::throwsIndexOutOfBounds(BasicBlock* BB) {
+  J3Intrinsics* intrinsics = TheCompiler->getIntrinsics();
+  for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+    if (I->getOpcode() == Instruction::Call ||
+        I->getOpcode() == Instruction::Invoke) {
+      CallSite Call(I);
+      if (Call.getCalledValue() ==
+          intrinsics->IndexOutOfBoundsExceptionFunction) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// The index takes the values Start + Offset, ..., Bound - 1 + Offset, where
+// Start < Bound. Computations are done on 64 bits so that they do not
+// overflow.
+Value* EliminateRangeChecks::getSafeCondition(Instruction* InsertPt,
+                                              Value* Start, Value* Bound,
+                                              Value* Length, int64_t Offset) {
+  Type* Int64 = Type::getInt64Ty(InsertPt->getContext());
+  Constant* Zero = ConstantInt::get(Int64, 0);
+  Constant* Off = ConstantInt::get(Int64, Offset, true);
+  Value* Start64 = new SExtInst(Start, Int64, "", InsertPt);
+  Value* Bound64 = new SExtInst(Bound, Int64, "", InsertPt);
+  Value* Length64 = new SExtInst(Length, Int64, "", InsertPt);
+
+  Value* First = BinaryOperator::CreateAdd(Start64, Off, "", InsertPt);
+  Value* Last = BinaryOperator::CreateAdd(Bound64, Off, "", InsertPt);
+  Value* c1 = new ICmpInst(InsertPt, ICmpInst::ICMP_SGE, Start64, Zero, "");
+  Value* c2 = new ICmpInst(InsertPt, ICmpInst::ICMP_SGE, First, Zero, "");
+  Value* c3 = new ICmpInst(InsertPt, ICmpInst::ICMP_SLT, Start64, Bound64, "");
+  Value* c4 = new ICmpInst(InsertPt, ICmpInst::ICMP_SLE, Last, Length64, "");
+  Value* Safe = BinaryOperator::CreateAnd(c1, c2, "", InsertPt);
+  Safe = BinaryOperator::CreateAnd(Safe, c3, "", InsertPt);
+  Safe = BinaryOperator::CreateAnd(Safe, c4, "safe range", InsertPt);
+  return Safe;
+}
+
+bool EliminateRangeChecks::runOnLoop(Loop* L) {
+  BasicBlock* Preheader = L->getLoopPreheader();
+  BasicBlock* Latch = L->getLoopLatch();
+  BasicBlock* Header = L->getHeader();
+  if (Preheader == NULL || Latch == NULL) return false;
+
+  // Look for the exit test of the latch: the loop continues while
+  // Next < Bound, where Next = IV + 1.
+  BranchInst* LatchBr = dyn_cast<BranchInst>(Latch->getTerminator());
+  if (LatchBr == NULL || !LatchBr->isConditional()) return false;
+  ICmpInst* ExitCmp = dyn_cast<ICmpInst>(LatchBr->getCondition());
+  if (ExitCmp == NULL) return false;
+
+  ICmpInst::Predicate Pred = ExitCmp->getPredicate();
+  if (LatchBr->getSuccessor(0) != Header) {
+    if (LatchBr->getSuccessor(1) != Header) return false;
+    Pred = ICmpInst::getInversePredicate(Pred);
+  }
+  Value* Next = ExitCmp->getOperand(0);
+  Value* Bound = ExitCmp->getOperand(1);
+  if (!L->isLoopInvariant(Bound)) {
+    std::swap(Next, Bound);
+    Pred = ICmpInst::getSwappedPredicate(Pred);
+  }
+  if (!L->isLoopInvariant(Bound)) return false;
+  if (Pred != ICmpInst::ICMP_SLT && Pred != ICmpInst::ICMP_ULT &&
+      Pred != ICmpInst::ICMP_NE) {
+    return false;
+  }
+
+  BinaryOperator* Inc = dyn_cast<BinaryOperator>(Next);
+  if (Inc == NULL || Inc->getOpcode() != Instruction::Add) return false;
+  PHINode* IV = dyn_cast<PHINode>(Inc->getOperand(0));
+  ConstantInt* Step = dyn_cast<ConstantInt>(Inc->getOperand(1));
+  if (IV == NULL) {
+    IV = dyn_cast<PHINode>(Inc->getOperand(1));
+    Step = dyn_cast<ConstantInt>(Inc->getOperand(0));
+  }
+  if (IV == NULL || Step == NULL || !Step->isOne()) return false;
+  if (IV->getParent() != Header || IV->getNumIncomingValues() != 2) {
+    return false;
+  }
+  if (!IV->getType()->isIntegerTy(32)) return false;
+  if (IV->getIncomingValueForBlock(Latch) != Inc) return false;
+  Value* Start = IV->getIncomingValueForBlock(Preheader);
+
+  bool Changed = false;
+  Instruction* InsertPt = Preheader->getTerminator();
+  std::map<std::pair<Value*, int64_t>, Value*> SafeConditions;
+
+  for (Loop::block_iterator BI = L->block_begin(), BE = L->block_end();
+       BI != BE; ++BI) {
+    BranchInst* Br = dyn_cast<BranchInst>((*BI)->getTerminator());
+    if (Br == NULL || !Br->isConditional()) continue;
+    ICmpInst* Cmp = dyn_cast<ICmpInst>(Br->getCondition());
+    if (Cmp == NULL) continue;
+
+    // Get the check in the form Index <u Length.
+    Value* Index = NULL;
+    Value* Length = NULL;
+    unsigned InBounds = 0;
+    switch (Cmp->getPredicate()) {
+      case ICmpInst::ICMP_ULT:
+        Index = Cmp->getOperand(0); Length = Cmp->getOperand(1);
+        break;
+      case ICmpInst::ICMP_UGT:
+        Index = Cmp->getOperand(1); Length = Cmp->getOperand(0);
+        break;
+      case ICmpInst::ICMP_UGE:
+        Index = Cmp->getOperand(0); Length = Cmp->getOperand(1);
+        InBounds = 1;
+        break;
+      case ICmpInst::ICMP_ULE:
+        Index = Cmp->getOperand(1); Length = Cmp->getOperand(0);
+        InBounds = 1;
+        break;
+      default:
+        continue;
+    }
+    BasicBlock* OutOfBounds = Br->getSuccessor(1 - InBounds);
+    if (L->contains(OutOfBounds) || !throwsIndexOutOfBounds(OutOfBounds)) {
+      continue;
+    }
+    if (!L->isLoopInvariant(Length)) continue;
+
+    int64_t Offset = 0;
+    if (Index != IV) {
+      BinaryOperator* Add = dyn_cast<BinaryOperator>(Index);
+      if (Add == NULL || Add->getOpcode() != Instruction::Add) continue;
+      ConstantInt* C = NULL;
+      if (Add->getOperand(0) == IV) {
+        C = dyn_cast<ConstantInt>(Add->getOperand(1));
+      } else if (Add->getOperand(1) == IV) {
+        C = dyn_cast<ConstantInt>(Add->getOperand(0));
+      }
+      if (C == NULL) continue;
+      Offset = C->getSExtValue();
+    }
+
+    Value*& Safe = SafeConditions[std::make_pair(Length, Offset)];
+    if (Safe == NULL) {
+      Safe = getSafeCondition(InsertPt, Start, Bound, Length, Offset);
+    }
+
+    Value* Cond = NULL;
+    if (InBounds == 0) {
+      Cond = BinaryOperator::CreateOr(Safe, Cmp, "", Br);
+    } else {
+      Value* Unsafe = BinaryOperator::CreateNot(Safe, "", InsertPt);
+      Cond = BinaryOperator::CreateAnd(Unsafe, Cmp, "", Br);
+    }
+    Br->setCondition(Cond);
+    Changed = true;
+  }
+  return Changed;
+}
+
+bool EliminateRangeChecks::runOnFunction(Function& F) {
+  LoopInfo& LI = getAnalysis<LoopInfo>();
+  std::vector<Loop*> Loops(LI.begin(), LI.end());
+  bool Changed = false;
+  while (!Loops.empty()) {
+    Loop* L = Loops.back();
+    Loops.pop_back();
+    Loops.insert(Loops.end(), L->getSubLoops().begin(),
+                 L->getSubLoops().end());
+    Changed |= runOnLoop(L);
+  }
+  return Changed;
+}
+
+
+FunctionPass* createEliminateRangeChecksPass(JavaLLVMCompiler* Compiler) {
+  return new EliminateRangeChecks(Compiler);
+}
+
+}
@@ -144,6 +144,8 @@ void J3Intrinsics::init(llvm::Module* module) {
   OffsetStaticInstanceInTaskClassMirrorConstant = constantThree;
   OffsetStatusInTaskClassMirrorConstant = constantZero;
   OffsetInitializedInTaskClassMirrorConstant = constantOne;
+  OffsetBiasRevocationsInClassConstant =
+    ConstantInt::get(Type::getInt32Ty(Context), 26);
   
   OffsetIsolateIDInThreadConstant =         ConstantInt::get(Type::getInt32Ty(Context), 1);
   OffsetVMInThreadConstant =                ConstantInt::get(Type::getInt32Ty(Context), 2);
@@ -165,6 +167,7 @@ void J3Intrinsics::init(llvm::Module* module) {
   GetConstantPoolAtFunction = module->getFunction("getConstantPoolAt");
   ArrayLengthFunction = module->getFunction("arrayLength");
   GetVTFunction = module->getFunction("getVT");
+  NullCheckFunction = module->getFunction("nullCheck");
   GetIMTFunction = module->getFunction("getIMT");
   GetClassFunction = module->getFunction("getClass");
   ClassLookupFunction = module->getFunction("j3ClassLookup");
@@ -179,12 +182,19 @@ void J3Intrinsics::init(llvm::Module* module) {
   RuntimeDelegateeFunction = module->getFunction("j3RuntimeDelegatee");
   IsSubclassOfFunction = module->getFunction("isSubclassOf");
   IsSecondaryClassFunction = module->getFunction("isSecondaryClass");
+  IsSecondaryTypeFunction = module->getFunction("j3IsSecondaryType");
   GetDepthFunction = module->getFunction("getDepth");
   GetStaticInstanceFunction = module->getFunction("getStaticInstance");
   GetDisplayFunction = module->getFunction("getDisplay");
   GetVTInDisplayFunction = module->getFunction("getVTInDisplay");
   AquireObjectFunction = module->getFunction("j3JavaObjectAquire");
   ReleaseObjectFunction = module->getFunction("j3JavaObjectRelease");
+  ArrayFillFunction = module->getFunction("j3ArrayFill");
+  ArrayEqualsFunction = module->getFunction("j3ArrayEquals");
+  StringEqualsFunction = module->getFunction("j3StringEquals");
+  StringHashCodeFunction = module->getFunction("j3StringHashCode");
+  StringIndexOfFunction = module->getFunction("j3StringIndexOf");
+  NanoTimeFunction = module->getFunction("j3NanoTime");
 
   VirtualFieldLookupFunction = module->getFunction("j3VirtualFieldLookup");
   StaticFieldLookupFunction = module->getFunction("j3StaticFieldLookup");
@@ -196,6 +206,8 @@ void J3Intrinsics::init(llvm::Module* module) {
   ResolveStaticStubFunction = module->getFunction("j3ResolveStaticStub");
   ResolveSpecialStubFunction = module->getFunction("j3ResolveSpecialStub");
   ResolveInterfaceFunction = module->getFunction("j3ResolveInterface");
+  InlineCacheMissFunction = module->getFunction("j3InlineCacheMiss");
+  CompileOSRFunction = module->getFunction("j3CompileOSR");
   
   NullPointerExceptionFunction =
     module->getFunction("j3NullPointerException");
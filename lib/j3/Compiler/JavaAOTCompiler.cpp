@@ -16,6 +16,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetRegistry.h"
 #include "llvm/Target/TargetData.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 
 #include "vmkit/UTF8.h"
 #include "vmkit/Thread.h"
@@ -1012,6 +1013,15 @@ Constant* JavaAOTCompiler::CreateConstantFromJavaMethod(JavaMethod& method) {
   // offset
   MethodElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), method.offset));
 
+  // invokeCache
+  MethodElts.push_back(Constant::getNullValue(JavaIntrinsics.ptrType));
+
+  // inlineCodeSize, inlineState: the summary is recomputed by the JIT of the
+  // loading VM.
+  MethodElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), 0));
+  MethodElts.push_back(ConstantInt::get(Type::getInt8Ty(getLLVMContext()),
+                                        JavaMethod::InlineUnknown));
+
   return ConstantStruct::get(STy, MethodElts); 
 }
 
@@ -1363,6 +1373,12 @@ Constant* JavaAOTCompiler::CreateConstantFromClass(Class* cl) {
   // staticSize
   ClassElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), cl->staticSize));
 
+  // memberIndex: built lazily at runtime.
+  ClassElts.push_back(Constant::getNullValue(JavaIntrinsics.ptrType));
+
+  // biasRevocations
+  ClassElts.push_back(ConstantInt::get(Type::getInt32Ty(getLLVMContext()), cl->biasRevocations));
+
   return ConstantStruct::get(STy, ClassElts);
 }
 
@@ -1563,6 +1579,91 @@ Function* JavaAOTCompiler::getMethod(JavaMethod* meth, Class* customizeFor) {
   return func;
 }
 
+// Get the address of the given global, tagged with 1.
+static Constant* getTaggedTable(Module& M, ArrayType* ATy,
+                                std::vector<Constant*>& Elemts,
+                                Type* pointerSizeType, Constant* One,
+                                PointerType* PTy) {
+  Constant* Array = ConstantArray::get(ATy, Elemts);
+  GlobalVariable* GV = new GlobalVariable(M, ATy, false,
+                                          GlobalValue::InternalLinkage,
+                                          Array, "");
+  Constant* CI = ConstantExpr::getPtrToInt(GV, pointerSizeType);
+  CI = ConstantExpr::getAdd(CI,
+    ConstantExpr::getIntegerCast(One, pointerSizeType, false));
+  return ConstantExpr::getIntToPtr(CI, PTy);
+}
+
+Constant* JavaAOTCompiler::CreateConstantFromIMTConflicts(
+    Class* cl, std::set<JavaMethod*>& atIndex, PointerType* PTy) {
+  // Group the interface methods by selector, see
+  // JavaJITCompiler::makeIMTConflictTable.
+  std::map<uint32_t, std::vector<JavaMethod*> > bySelector;
+  for (std::set<JavaMethod*>::iterator it = atIndex.begin(),
+       et = atIndex.end(); it != et; ++it) {
+    JavaMethod* Imeth = *it;
+    uint32_t selector =
+      InterfaceMethodTable::getSelector(Imeth->name, Imeth->type);
+    bySelector[selector].push_back(Imeth);
+  }
+
+  std::vector<uint32_t> selectors;
+  for (std::map<uint32_t, std::vector<JavaMethod*> >::iterator
+       it = bySelector.begin(), et = bySelector.end(); it != et; ++it) {
+    selectors.push_back(it->first);
+  }
+  uint32_t multiplier = 0;
+  uint32_t shift = InterfaceMethodTable::findPerfectHash(selectors, multiplier);
+  uint32_t length = InterfaceMethodTable::ConflictHeader + (1 << (32 - shift));
+
+  std::vector<Constant*> TableElemts(length, ConstantPointerNull::get(PTy));
+  TableElemts[0] = ConstantExpr::getIntToPtr(
+      ConstantInt::get(JavaIntrinsics.pointerSizeType, multiplier), PTy);
+  TableElemts[1] = ConstantExpr::getIntToPtr(
+      ConstantInt::get(JavaIntrinsics.pointerSizeType, shift), PTy);
+
+  for (std::map<uint32_t, std::vector<JavaMethod*> >::iterator
+       it = bySelector.begin(), et = bySelector.end(); it != et; ++it) {
+    std::vector<JavaMethod*>& methods = it->second;
+    uint32_t index = InterfaceMethodTable::getConflictIndex(it->first,
+                                                            multiplier, shift);
+    std::vector<JavaMethod*> targets;
+    bool SameMethod = true;
+    for (uint32_t j = 0; j < methods.size(); ++j) {
+      JavaMethod* Cmeth = cl->lookupMethodDontThrow(methods[j]->name,
+                                                    methods[j]->type,
+                                                    false, true, 0);
+      assert(Cmeth && "No method found");
+      if (j != 0 && Cmeth != targets[0]) SameMethod = false;
+      targets.push_back(Cmeth);
+    }
+
+    if (SameMethod) {
+      Function* func = getMethodOrStub(targets[0], cl);
+      TableElemts[index] = ConstantExpr::getBitCast(func, PTy);
+    } else {
+      // Different methods with the same selector: a NULL-terminated list.
+      std::vector<Constant*> ListElemts;
+      for (uint32_t j = 0; j < methods.size(); ++j) {
+        Function* func = getMethodOrStub(targets[j], cl);
+        ListElemts.push_back(
+          ConstantExpr::getBitCast(getMethodInClass(methods[j]), PTy));
+        ListElemts.push_back(ConstantExpr::getBitCast(func, PTy));
+      }
+      ListElemts.push_back(ConstantPointerNull::get(PTy));
+      ArrayType* ATy = ArrayType::get(PTy, ListElemts.size());
+      TableElemts[index] = getTaggedTable(*getLLVMModule(), ATy, ListElemts,
+                                          JavaIntrinsics.pointerSizeType,
+                                          JavaIntrinsics.constantOne, PTy);
+    }
+  }
+
+  ArrayType* ATy = ArrayType::get(PTy, length);
+  return getTaggedTable(*getLLVMModule(), ATy, TableElemts,
+                        JavaIntrinsics.pointerSizeType,
+                        JavaIntrinsics.constantOne, PTy);
+}
+
 Constant* JavaAOTCompiler::CreateConstantFromVT(JavaVirtualTable* VT) {
   CommonClass* classDef = VT->cl;
   uint32 size = classDef->isClass() ? classDef->asClass()->virtualTableSize :
@@ -1731,41 +1832,7 @@ Constant* JavaAOTCompiler::CreateConstantFromVT(JavaVirtualTable* VT) {
           Function* func = getMethodOrStub(methods[0], maybeCustomize);
           IElemts.push_back(ConstantExpr::getBitCast(func, PTy));
         } else {
-
-          uint32_t length = 2 * size;
-        
-          ArrayType* ATy = 
-            dyn_cast<ArrayType>(JavaIntrinsics.VTType->getContainedType(0));
-          ATy = ArrayType::get(PTy, length);
-          std::vector<Constant*> InternalElemts;
-     
-
-          std::set<JavaMethod*>::iterator Interf = atIndex.begin();
-          for (std::vector<JavaMethod*>::iterator it = methods.begin(),
-               et = methods.end(); it != et; ++it, ++Interf) {
-            JavaMethod* Imeth = *Interf;
-            JavaMethod* Cmeth = *it;
-            assert(Cmeth && "No method found");
-
-            Function* func = getMethodOrStub(Cmeth, maybeCustomize);
-            InternalElemts.push_back(
-              ConstantExpr::getBitCast(getMethodInClass(Imeth), PTy));
-            InternalElemts.push_back(ConstantExpr::getBitCast(func, PTy));
-          }
-          Constant* Array = ConstantArray::get(ATy, InternalElemts);
-    
-          GlobalVariable* GV = new GlobalVariable(*getLLVMModule(), ATy, false,
-                                                  GlobalValue::InternalLinkage,
-                                                  Array, "");
-     
-          Constant* CI =
-            ConstantExpr::getPtrToInt(GV, JavaIntrinsics.pointerSizeType);
-          CI = ConstantExpr::getAdd(CI,
-            ConstantExpr::getIntegerCast(JavaIntrinsics.constantOne,
-                                         JavaIntrinsics.pointerSizeType,
-                                         false));
-          CI = ConstantExpr::getIntToPtr(CI, PTy);
-          IElemts.push_back(CI);
+          IElemts.push_back(CreateConstantFromIMTConflicts(cl, atIndex, PTy));
         }
       } else {
         IElemts.push_back(N);
@@ -1820,6 +1887,7 @@ JavaAOTCompiler::JavaAOTCompiler(const std::string& ModuleID) :
   compileRT = false;
   precompile = false;
   emitClassBytes = false;
+  hasProfile = false;
 
   std::vector<llvm::Type*> llvmArgs;
   FunctionType* FTy = FunctionType::get(
@@ -2032,6 +2100,52 @@ Value* JavaAOTCompiler::addCallback(Class* cl, uint16 index,
   return func;
 }
 
+static std::string profileKey(const char* cl, const char* name,
+                              const char* type) {
+  std::string key(cl);
+  key += '.';
+  key += name;
+  key += type;
+  return key;
+}
+
+bool JavaAOTCompiler::readProfile(const char* fileName) {
+  FILE* file = fopen(fileName, "r");
+  if (file == NULL) return false;
+  char line[4096];
+  char className[1024];
+  char methName[1024];
+  char methType[1024];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    char event = 0;
+    char tag = 0;
+    int nb = sscanf(line, "%c %c %1023s %1023s %1023s", &event, &tag,
+                    className, methName, methType);
+    if (nb == 5 && event == 'C') {
+      hotMethods.insert(profileKey(className, methName, methType));
+    }
+  }
+  fclose(file);
+  hasProfile = true;
+  return true;
+}
+
+bool JavaAOTCompiler::isHot(JavaMethod* meth) {
+  if (!hasProfile) return true;
+  return hotMethods.count(profileKey(UTF8Buffer(meth->classDef->name).cString(),
+                                     UTF8Buffer(meth->name).cString(),
+                                     UTF8Buffer(meth->type).cString())) != 0;
+}
+
+void JavaAOTCompiler::applyProfile(JavaMethod* meth, Function* func) {
+  if (!hasProfile || func->hasFnAttr(Attribute::NoInline)) return;
+  if (isHot(meth)) {
+    func->addFnAttr(Attribute::InlineHint);
+  } else {
+    func->addFnAttr(Attribute::OptimizeForSize);
+  }
+}
+
 void JavaAOTCompiler::compileClass(Class* cl) {
   
   // Make sure the class is emitted.
@@ -2039,13 +2153,17 @@ void JavaAOTCompiler::compileClass(Class* cl) {
 
   for (uint32 i = 0; i < cl->nbVirtualMethods; ++i) {
     JavaMethod& meth = cl->virtualMethods[i];
-    if (!isAbstract(meth.access)) parseFunction(&meth, NULL);
+    if (!isAbstract(meth.access)) {
+      applyProfile(&meth, parseFunction(&meth, NULL));
+    }
     if (generateStubs) compileAllStubs(meth.getSignature());
   }
   
   for (uint32 i = 0; i < cl->nbStaticMethods; ++i) {
     JavaMethod& meth = cl->staticMethods[i];
-    if (!isAbstract(meth.access)) parseFunction(&meth, NULL);
+    if (!isAbstract(meth.access)) {
+      applyProfile(&meth, parseFunction(&meth, NULL));
+    }
     if (generateStubs) compileAllStubs(meth.getSignature());
   }
 }
@@ -2287,6 +2405,71 @@ end:
   vm->threadSystem.leave(); 
 }
 
+static uint32 getPartition(JavaMethod* meth, uint32 nbParts) {
+  if (meth == NULL) return 0;
+  const UTF8* name = meth->classDef->name;
+  sint32 end = name->size;
+  while (end > 0 && name->elements[end - 1] != '/') --end;
+  uint32 hash = 0;
+  for (sint32 i = 0; i < end; ++i) hash = hash * 31 + name->elements[i];
+  return hash % nbParts;
+}
+
+void JavaAOTCompiler::splitModule(uint32 nbParts,
+                                  std::vector<llvm::Module*>& parts) {
+  Module* Mod = getLLVMModule();
+
+  // Symbols with local linkage may be referenced from another part: make
+  // them visible to the other objects of the image, but not outside of it.
+  uint32 anonymous = 0;
+  for (Module::global_iterator I = Mod->global_begin(),
+       E = Mod->global_end(); I != E; ++I) {
+    if (I->hasLocalLinkage()) {
+      if (!I->hasName()) I->setName("aot.anon." + Twine(anonymous++));
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+  }
+
+  std::vector<uint32> partitions;
+  for (Module::iterator I = Mod->begin(), E = Mod->end(); I != E; ++I) {
+    if (I->hasLocalLinkage()) {
+      if (!I->hasName()) I->setName("aot.anon." + Twine(anonymous++));
+      I->setLinkage(GlobalValue::ExternalLinkage);
+      I->setVisibility(GlobalValue::HiddenVisibility);
+    }
+    partitions.push_back(getPartition(getJavaMethod(*I), nbParts));
+  }
+
+  for (uint32 part = 0; part < nbParts; ++part) {
+    Module* M = CloneModule(Mod);
+    M->setModuleIdentifier(Mod->getModuleIdentifier() + "_" + Twine(part).str());
+
+    uint32 index = 0;
+    for (Module::iterator I = M->begin(), E = M->end(); I != E; ++I, ++index) {
+      if (partitions[index] != part && !I->isDeclaration()) {
+        I->deleteBody();
+      }
+    }
+    assert(index == partitions.size());
+
+    if (part != 0) {
+      for (Module::global_iterator I = M->global_begin(),
+           E = M->global_end(); I != E;) {
+        GlobalVariable* GV = I++;
+        if (GV->hasAppendingLinkage()) {
+          // Constructors and used lists are emitted by the first part only.
+          GV->eraseFromParent();
+        } else if (!GV->isDeclaration()) {
+          GV->setInitializer(NULL);
+          GV->setLinkage(GlobalValue::ExternalLinkage);
+        }
+      }
+    }
+    parts.push_back(M);
+  }
+}
+
 void JavaAOTCompiler::compileFile(Jnjvm* vm, const char* n) {
   name = n;
   JavaThread* th = new JavaThread(vm);
@@ -2325,17 +2508,20 @@ void JavaAOTCompiler::compileClassLoader(JnjvmBootstrapLoader* loader) {
     }
   }
 
+  // With a profile, only the methods it lists are seeded. Methods they call
+  // directly are still compiled below; the others are left to the JIT and
+  // reached through stubs.
   for (method_info_iterator I = jitCompiler->method_infos.begin(),
        E = jitCompiler->method_infos.end(); I != E; I++) {
-    if (!isAbstract(I->first->access)) {
+    if (!isAbstract(I->first->access) && isHot(I->first)) {
       LLVMMethodInfo* LMI = I->second;
       if (LMI->methodFunction) {
-        parseFunction(I->first, NULL);
+        applyProfile(I->first, parseFunction(I->first, NULL));
       }
       for (std::map<Class*, Function*>::iterator
            CI = LMI->customizedVersions.begin(),
            CE = LMI->customizedVersions.end(); CI != CE; CI++) {
-        parseFunction(I->first, CI->first);
+        applyProfile(I->first, parseFunction(I->first, CI->first));
       }
     }
   }
@@ -2346,7 +2532,7 @@ void JavaAOTCompiler::compileClassLoader(JnjvmBootstrapLoader* loader) {
     // parseFunction may introduce new functions to compile, so
     // pop toCompile before calling parseFunction.
     toCompile.pop_back();
-    parseFunction(meth, customizeFor);
+    applyProfile(meth, parseFunction(meth, customizeFor));
   }
 
   // Make sure classes and arrays already referenced in constant pools
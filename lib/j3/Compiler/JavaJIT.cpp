@@ -27,6 +27,7 @@
 #include "vmkit/JIT.h"
 
 #include "debug.h"
+#include "ClassHierarchy.h"
 #include "JavaArray.h"
 #include "JavaClass.h"
 #include "JavaConstantPool.h"
@@ -92,11 +93,147 @@ void JavaJIT::checkYieldPoint() {
   currentBlock = continueBlock;
 }
 
+// The replaced frame and the replacing one must agree on the state of the
+// method: it is only the locals, so the operand stack must be empty. The
+// exception handlers and the lock of a synchronized method would stay in
+// the replaced frame.
+bool JavaJIT::canReplaceOnStack() {
+  return osrIndex < 0 && !inlining && !TheCompiler->isStaticCompiling() &&
+         nbHandlers == 0 && !isSynchro(compilingMethod->access) &&
+         stack.empty();
+}
+
+std::vector<AllocaInst*>& JavaJIT::getLocalsOfKind(uint32 kind) {
+  switch (kind) {
+    case 0: return intLocals;
+    case 1: return doubleLocals;
+    case 2: return longLocals;
+    case 3: return floatLocals;
+    default: return objectLocals;
+  }
+}
+
+Value* JavaJIT::getOSRSlot(Value* buffer, uint32 local, uint32 kind,
+                           Type* type) {
+  Value* index = ConstantInt::get(Type::getInt32Ty(*llvmContext),
+                                  local * NumOSRKinds + kind);
+  Value* slot = GetElementPtrInst::Create(buffer, index, "", currentBlock);
+  return new BitCastInst(slot, PointerType::getUnqual(type), "",
+                         currentBlock);
+}
+
+void JavaJIT::checkOnStackReplacement(uint32 index) {
+  // The count lives in the frame: only a long running activation needs to
+  // be replaced, and threads do not share the counter.
+  Type* wordType = intrinsics->pointerSizeType;
+  if (osrCount == NULL) {
+    BasicBlock& entry = llvmFunction->getEntryBlock();
+    AllocaInst* count = new AllocaInst(wordType, "", &*entry.begin());
+    BasicBlock::iterator next = count;
+    ++next;
+    new StoreInst(ConstantInt::get(wordType, 0), count, &*next);
+    osrCount = count;
+  }
+  Value* val = new LoadInst(osrCount, "", currentBlock);
+  val = BinaryOperator::CreateAdd(val, ConstantInt::get(wordType, 1), "",
+                                  currentBlock);
+  new StoreInst(val, osrCount, currentBlock);
+  val = BinaryOperator::CreateAnd(val,
+                                  ConstantInt::get(wordType, OSRInterval - 1),
+                                  "", currentBlock);
+  val = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, val,
+                     ConstantInt::get(wordType, 0), "");
+
+  BasicBlock* compileBlock = createBasicBlock("OSR compile");
+  BasicBlock* transferBlock = createBasicBlock("OSR transfer");
+  BasicBlock* continueBlock = createBasicBlock("no OSR");
+  BranchInst::Create(compileBlock, continueBlock, val, currentBlock);
+
+  // The runtime compiles the version once, and caches it.
+  currentBlock = compileBlock;
+  Value* code = invoke(intrinsics->CompileOSRFunction,
+                       TheCompiler->getMethodInClass(compilingMethod),
+                       ConstantInt::get(Type::getInt32Ty(*llvmContext), index),
+                       "", currentBlock);
+  val = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, code,
+                     intrinsics->constantPtrNull, "");
+  BranchInst::Create(transferBlock, continueBlock, val, currentBlock);
+
+  // Copy the locals and finish the method in the new version. Nothing can
+  // move the objects between the copy and the new frame loading them. The
+  // object locals of this frame are cleared, so that it does not keep them
+  // alive while the new frame runs.
+  currentBlock = transferBlock;
+  uint32 nbLocals = intLocals.size();
+  if (osrBuffer == NULL) {
+    BasicBlock& entry = llvmFunction->getEntryBlock();
+    osrBuffer = new AllocaInst(
+        Type::getInt64Ty(*llvmContext),
+        ConstantInt::get(Type::getInt32Ty(*llvmContext),
+                         nbLocals * NumOSRKinds),
+        "", &*entry.begin());
+  }
+  for (uint32 i = 0; i < nbLocals; ++i) {
+    for (uint32 kind = 0; kind < NumOSRKinds; ++kind) {
+      AllocaInst* local = getLocalsOfKind(kind)[i];
+      Value* slot = getOSRSlot(osrBuffer, i, kind,
+                               local->getAllocatedType());
+      new StoreInst(new LoadInst(local, "", currentBlock), slot,
+                    currentBlock);
+      if (kind == NumOSRKinds - 1) {
+        new StoreInst(Constant::getNullValue(local->getAllocatedType()),
+                      local, currentBlock);
+      }
+    }
+  }
+  FunctionType* type = FunctionType::get(llvmFunction->getReturnType(),
+                                         intrinsics->ptrType, false);
+  code = new BitCastInst(code, PointerType::getUnqual(type), "",
+                         currentBlock);
+  Value* buffer = new BitCastInst(osrBuffer, intrinsics->ptrType, "",
+                                  currentBlock);
+  Value* res = invoke(code, buffer, "", currentBlock);
+  if (endNode != NULL) {
+    endNode->addIncoming(res, currentBlock);
+  }
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = continueBlock;
+}
+
+void JavaJIT::loadOSRLocals(Value* buffer) {
+  buffer = new BitCastInst(buffer,
+                           PointerType::getUnqual(Type::getInt64Ty(*llvmContext)),
+                           "", currentBlock);
+  for (uint32 i = 0; i < intLocals.size(); ++i) {
+    for (uint32 kind = 0; kind < NumOSRKinds; ++kind) {
+      AllocaInst* local = getLocalsOfKind(kind)[i];
+      Value* slot = getOSRSlot(buffer, i, kind, local->getAllocatedType());
+      new StoreInst(new LoadInst(slot, "", currentBlock), local,
+                    currentBlock);
+    }
+  }
+  if (isVirtual(compilingMethod->access)) {
+    thisObject = objectLocals[0];
+  }
+}
+
 bool JavaJIT::canBeInlined(JavaMethod* meth, bool customizing) {
-  if (inlineMethods[meth]) return false;
+  if (inlineMethods[meth]) {
+    sawRecursion = true;
+    return false;
+  }
+
   if (isSynchro(meth->access)) return false;
   if (isNative(meth->access)) return false;
 
+  if (meth->inlineState == JavaMethod::Inlinable) return true;
+  // Customization only makes more methods inlinable.
+  bool customized = customizing && customizeFor != NULL;
+  if (meth->inlineState == JavaMethod::NotInlinable && !customized) {
+    return false;
+  }
+
   Attribut* codeAtt = meth->lookupAttribut(Attribut::codeAttribut);
   if (codeAtt == NULL) return false;
 
@@ -104,18 +241,38 @@ bool JavaJIT::canBeInlined(JavaMethod* meth, bool customizing) {
   /* uint16 maxStack = */ reader.readU2();
   /* uint16 maxLocals = */ reader.readU2();
   uint32 codeLen = reader.readU4();
-  uint32 start = reader.cursor; 
-  reader.seek(codeLen, Reader::SeekCur);
-  uint16 handlers = reader.readU2();
-  if (handlers != 0) return false;
-  reader.cursor = start;
 
   JavaJIT jit(TheCompiler, meth, llvmFunction, customizing ? customizeFor : NULL);
   jit.inlineMethods = inlineMethods;
   jit.inlineMethods[meth] = true;
-  if (!jit.analyzeForInlining(reader, codeLen)) return false;
-  jit.inlineMethods[meth] = false;
-  return true;
+  bool result = jit.analyzeForInlining(reader, codeLen);
+  sawRecursion |= jit.sawRecursion;
+  sawUnresolved |= jit.sawUnresolved;
+  // The analysis counts the callees it expects to be inlined, so that the
+  // budget also covers them when the summary is reused.
+  meth->inlineCodeSize = codeLen + jit.inlinedSize;
+
+  // A refusal caused by a method being inlined depends on the call stack, and
+  // one caused by resolution or initialisation may not hold later: only
+  // cache the permanent refusals.
+  if (result && !customized) {
+    meth->inlineState = JavaMethod::Inlinable;
+  } else if (!result && !customized && !jit.sawRecursion &&
+             !jit.sawUnresolved) {
+    meth->inlineState = JavaMethod::NotInlinable;
+  }
+  return result;
+}
+
+bool JavaJIT::shouldInline(JavaMethod* meth, bool customizing,
+                           InlineCache* cache) {
+  if (!canBeInlined(meth, customizing)) return false;
+  uint32 maxSize = MaxInlineSize;
+  if (cache != NULL && cache->isMonomorphic() && cache->isHot()) {
+    maxSize = MaxHotInlineSize;
+  }
+  if (meth->inlineCodeSize > maxSize) return false;
+  return inlinedSize + meth->inlineCodeSize <= InlineBudget;
 }
 
 bool JavaJIT::isThisReference(int stackIndex) {
@@ -193,7 +350,18 @@ void JavaJIT::invokeVirtual(uint16 index) {
   llvm::Type* retType = virtualType->getReturnType();
 
   bool needsInit = false;
-  if (canBeDirect && canBeInlined(meth, customized)) {
+  InlineCache* cache = NULL;
+  word_t* guard = NULL;
+  JavaMethod* chaTarget = NULL;
+  Function* intrinsic = NULL;
+  if (!canBeDirect && meth) chaTarget = getCHATarget(meth, guard);
+  if (canBeDirect) intrinsic = getStringIntrinsic(meth, signature);
+
+  if (intrinsic != NULL) {
+    makeArgs(it, index, args, signature->nbArguments + 1);
+    if (!thisReference) JITVerifyNull(args[0]);
+    val = CallInst::Create(intrinsic, args, "", currentBlock);
+  } else if (canBeDirect && shouldInline(meth, customized)) {
     makeArgs(it, index, args, signature->nbArguments + 1);
     if (!thisReference) JITVerifyNull(args[0]);
     val = invokeInline(meth, args, customized);
@@ -203,6 +371,30 @@ void JavaJIT::invokeVirtual(uint16 index) {
     if (!thisReference) JITVerifyNull(args[0]);
     val = invoke(TheCompiler->getMethod(meth, customized ? customizeFor : NULL),
                  args, "", currentBlock);
+  } else if (chaTarget != NULL) {
+    makeArgs(it, index, args, signature->nbArguments + 1);
+    if (!thisReference) JITVerifyNull(args[0]);
+    BasicBlock* invalidatedBlock = createBasicBlock("CHA invalidated");
+    BasicBlock* endBlock = createBasicBlock("end CHA call");
+    Value* direct = invokeCHATarget(chaTarget, guard, args,
+                                    invalidatedBlock);
+    BasicBlock* directEnd = currentBlock;
+    currentBlock = invalidatedBlock;
+    Value* virt = invokeThroughVT(meth, args, LSI);
+    val = joinCalls(direct, directEnd, virt, endBlock);
+  } else if (meth && (cache = getInlineCache()) != NULL &&
+             !cache->isMegamorphic()) {
+    makeArgs(it, index, args, signature->nbArguments + 1);
+    if (!thisReference) JITVerifyNull(args[0]);
+    Value* Meth = TheCompiler->getMethodInClass(meth);
+    Class* receiver = NULL;
+    JavaMethod* target = getProfiledTarget(cache, meth, receiver);
+    if (target != NULL) {
+      val = invokeProfiledDirect(target, receiver, meth, Meth, NULL, cache,
+                                 args, LSI);
+    } else {
+      val = invokeInlineCache(cache, meth, Meth, NULL, args, LSI);
+    }
   } else {
 
     BasicBlock* endBlock = 0;
@@ -285,6 +477,368 @@ void JavaJIT::invokeVirtual(uint16 index) {
   }
 }
 
+InlineCache* JavaJIT::getInlineCache() {
+  // Inline caches hold runtime pointers, they can not be emitted ahead of
+  // time.
+  if (TheCompiler->isStaticCompiling()) return NULL;
+  LLVMMethodInfo* LMI = TheCompiler->getMethodInfo(compilingMethod);
+  InlineCache*& cache = LMI->inlineCaches[currentBytecodeIndex];
+  if (cache == NULL) {
+    cache = new (compilingClass->classLoader->allocator, "Inline cache")
+      InlineCache();
+  }
+  return cache;
+}
+
+word_t* JavaJIT::getTypeCheckMisses() {
+  if (TheCompiler->isStaticCompiling()) return NULL;
+  LLVMMethodInfo* LMI = TheCompiler->getMethodInfo(compilingMethod);
+  word_t*& misses = LMI->typeCheckMisses[currentBytecodeIndex];
+  if (misses == NULL) {
+    misses = (word_t*)compilingClass->classLoader->allocator.Allocate(
+        sizeof(word_t), "Type check misses");
+  }
+  return misses;
+}
+
+Value* JavaJIT::isSecondaryType(Value* VT, Value* otherVT) {
+  BasicBlock* slowBlock = createBasicBlock("secondary type miss");
+  BasicBlock* endBlock = createBasicBlock("end secondary type");
+  PHINode* node = PHINode::Create(Type::getInt1Ty(*llvmContext), 2, "",
+                                  endBlock);
+
+  Value* indices[2] = {
+    intrinsics->constantZero,
+    ConstantInt::get(Type::getInt32Ty(*llvmContext),
+                     JavaVirtualTable::getCacheIndex()) };
+  Value* CachePtr = GetElementPtrInst::Create(VT, indices, "", currentBlock);
+  CachePtr = new BitCastInst(CachePtr,
+                             PointerType::getUnqual(intrinsics->VTType), "",
+                             currentBlock);
+  Value* Cache = new LoadInst(CachePtr, "", currentBlock);
+  Value* cmp1 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, Cache, otherVT,
+                             "");
+  Value* cmp2 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, VT, otherVT,
+                             "");
+  Value* hit = BinaryOperator::CreateOr(cmp1, cmp2, "", currentBlock);
+  node->addIncoming(ConstantInt::getTrue(*llvmContext), currentBlock);
+  BranchInst::Create(endBlock, slowBlock, hit, currentBlock);
+
+  currentBlock = slowBlock;
+  word_t* misses = getTypeCheckMisses();
+  Value* Misses = intrinsics->constantPtrNull;
+  if (misses != NULL) {
+    Misses = ConstantExpr::getIntToPtr(
+        ConstantInt::get(Type::getInt64Ty(*llvmContext), uint64_t(misses)),
+        intrinsics->ptrType);
+  }
+  Value* Args[3] = { VT, otherVT, Misses };
+  Value* res = CallInst::Create(intrinsics->IsSecondaryTypeFunction, Args, "",
+                                currentBlock);
+  res = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, res,
+                     ConstantInt::get(Type::getInt8Ty(*llvmContext), 0), "");
+  node->addIncoming(res, currentBlock);
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = endBlock;
+  return node;
+}
+
+JavaMethod* JavaJIT::getProfiledTarget(InlineCache* cache, JavaMethod* meth,
+                                       Class*& receiver) {
+  // The only miss of the call site is the one that filled the cache, and
+  // the call site is hot.
+  if (meth == NULL || !cache->isMonomorphic() || cache->misses > 1 ||
+      !cache->isHot()) {
+    return NULL;
+  }
+  JavaVirtualTable* VT = (JavaVirtualTable*)cache->entries[0];
+  if (!VT->cl->isClass()) return NULL;
+  receiver = VT->cl->asClass();
+  JavaMethod* target = receiver->lookupMethodDontThrow(
+      meth->name, meth->type, false, true, NULL);
+  if (target == NULL || isAbstract(target->access)) return NULL;
+  bool needsInit = false;
+  Class* customized =
+    TheCompiler->getMethodInfo(target)->isCustomizable ? receiver : NULL;
+  if (TheCompiler->needsCallback(target, customized, &needsInit)) return NULL;
+  return target;
+}
+
+Value* JavaJIT::getVirtualCode(JavaMethod* meth, Value* obj,
+                              PointerType* codeType) {
+  Value* indexes[2] = { intrinsics->constantZero,
+                        TheCompiler->getMethodInfo(meth)->getOffset() };
+  Value* VT = CallInst::Create(intrinsics->GetVTFunction, obj, "",
+                               currentBlock);
+  Value* FuncPtr = GetElementPtrInst::Create(VT, indexes, "", currentBlock);
+  Value* Func = new LoadInst(FuncPtr, "", currentBlock);
+  return new BitCastInst(Func, codeType, "", currentBlock);
+}
+
+Value* JavaJIT::getInterfaceCode(Value* obj, Value* Meth, Value* Index,
+                                 PointerType* codeType) {
+  Type* wordType = intrinsics->pointerSizeType;
+  Type* wordPtrType = PointerType::getUnqual(wordType);
+  Type* int32Type = Type::getInt32Ty(*llvmContext);
+  Value* one = ConstantInt::get(wordType, 1);
+  Value* zero = ConstantInt::get(wordType, 0);
+  uint32_t selector = cast<ConstantInt>(Index)->getZExtValue();
+
+  BasicBlock* conflictBlock = createBasicBlock("IMT conflict");
+  BasicBlock* sameSelectorBlock = createBasicBlock("IMT same selector");
+  BasicBlock* endBlock = createBasicBlock("end IMT lookup");
+  PHINode* node = PHINode::Create(wordType, 3, "", endBlock);
+
+  // Load the slot of the selector.
+  Value* VT = CallInst::Create(intrinsics->GetVTFunction, obj, "",
+                               currentBlock);
+  Value* IMT = CallInst::Create(intrinsics->GetIMTFunction, VT, "",
+                                currentBlock);
+  IMT = new BitCastInst(IMT, wordPtrType, "", currentBlock);
+  Value* slot =
+    ConstantInt::get(int32Type, InterfaceMethodTable::getIndex(selector));
+  Value* entryPtr = GetElementPtrInst::Create(IMT, slot, "", currentBlock);
+  Value* entry = new LoadInst(entryPtr, "", currentBlock);
+  Value* tag = BinaryOperator::CreateAnd(entry, one, "", currentBlock);
+  Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, tag, zero, "");
+  node->addIncoming(entry, currentBlock);
+  BranchInst::Create(endBlock, conflictBlock, test, currentBlock);
+
+  // The slot is a conflict table: load the entry of the perfect hash.
+  currentBlock = conflictBlock;
+  Value* table = BinaryOperator::CreateAnd(
+      entry, ConstantInt::get(wordType, -2), "", currentBlock);
+  table = new IntToPtrInst(table, wordPtrType, "", currentBlock);
+  Value* multiplier = new LoadInst(table, "", currentBlock);
+  multiplier = CastInst::CreateTruncOrBitCast(multiplier, int32Type, "",
+                                              currentBlock);
+  Value* shiftPtr = GetElementPtrInst::Create(
+      table, ConstantInt::get(int32Type, 1), "", currentBlock);
+  Value* shift = new LoadInst(shiftPtr, "", currentBlock);
+  shift = CastInst::CreateTruncOrBitCast(shift, int32Type, "", currentBlock);
+  Value* hash = BinaryOperator::CreateMul(
+      ConstantInt::get(int32Type, selector), multiplier, "", currentBlock);
+  hash = BinaryOperator::CreateLShr(hash, shift, "", currentBlock);
+  hash = BinaryOperator::CreateAdd(
+      hash, ConstantInt::get(int32Type, InterfaceMethodTable::ConflictHeader),
+      "", currentBlock);
+  entryPtr = GetElementPtrInst::Create(table, hash, "", currentBlock);
+  entry = new LoadInst(entryPtr, "", currentBlock);
+  tag = BinaryOperator::CreateAnd(entry, one, "", currentBlock);
+  test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, tag, zero, "");
+  node->addIncoming(entry, currentBlock);
+  BranchInst::Create(endBlock, sameSelectorBlock, test, currentBlock);
+
+  // Methods with the same selector are searched by the runtime.
+  currentBlock = sameSelectorBlock;
+  std::vector<Value*> Args;
+  Args.push_back(obj);
+  Args.push_back(Meth);
+  Args.push_back(Index);
+  Value* code = invoke(intrinsics->ResolveInterfaceFunction, Args, "",
+                       currentBlock);
+  code = new PtrToIntInst(code, wordType, "", currentBlock);
+  node->addIncoming(code, currentBlock);
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = endBlock;
+  return new IntToPtrInst(node, codeType, "", currentBlock);
+}
+
+Value* JavaJIT::invokeInlineCache(InlineCache* cache, JavaMethod* meth,
+                                  Value* Meth, Value* Index,
+                                  std::vector<Value*>& args,
+                                  LLVMSignatureInfo* LSI) {
+  Type* wordType = intrinsics->pointerSizeType;
+  Type* wordPtrType = PointerType::getUnqual(wordType);
+  Constant* Entries = ConstantExpr::getIntToPtr(
+      ConstantInt::get(Type::getInt64Ty(*llvmContext),
+                       uint64_t(cache->entries)), wordPtrType);
+  Constant* Hits = ConstantExpr::getIntToPtr(
+      ConstantInt::get(Type::getInt64Ty(*llvmContext),
+                       uint64_t(&cache->hits)), wordPtrType);
+
+  Value* VT = CallInst::Create(intrinsics->GetVTFunction, args[0], "",
+                               currentBlock);
+  VT = new PtrToIntInst(VT, wordType, "", currentBlock);
+
+  BasicBlock* endBlock = createBasicBlock("end inline cache");
+  PHINode* node = PHINode::Create(wordType, InlineCache::NumEntries + 2, "",
+                                  endBlock);
+
+  Value* lastVT = NULL;
+  for (uint32 i = 0; i < InlineCache::NumEntries; ++i) {
+    Value* VTPtr = GetElementPtrInst::Create(
+        Entries, ConstantInt::get(Type::getInt32Ty(*llvmContext), 2 * i), "",
+        currentBlock);
+    Value* cachedVT = new LoadInst(VTPtr, "", currentBlock);
+    lastVT = cachedVT;
+    Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, cachedVT, VT,
+                               "");
+    BasicBlock* hitBlock = createBasicBlock("inline cache hit");
+    BasicBlock* nextBlock = createBasicBlock("inline cache next");
+    BranchInst::Create(hitBlock, nextBlock, test, currentBlock);
+
+    currentBlock = hitBlock;
+    if (i == 0) {
+      // Count the hits of the first entry until the call site is hot. Once
+      // it is, the counter is only read, and threads stop writing it.
+      Value* hits = new LoadInst(Hits, "", currentBlock);
+      Value* cold = new ICmpInst(*currentBlock, ICmpInst::ICMP_ULT, hits,
+                                 ConstantInt::get(wordType,
+                                                  InlineCache::HotHits), "");
+      BasicBlock* countBlock = createBasicBlock("inline cache count");
+      BasicBlock* countedBlock = createBasicBlock("inline cache counted");
+      BranchInst::Create(countBlock, countedBlock, cold, currentBlock);
+      currentBlock = countBlock;
+      hits = BinaryOperator::CreateAdd(hits, ConstantInt::get(wordType, 1),
+                                       "", currentBlock);
+      new StoreInst(hits, Hits, currentBlock);
+      BranchInst::Create(countedBlock, currentBlock);
+      currentBlock = countedBlock;
+    }
+    Value* codePtr = GetElementPtrInst::Create(
+        Entries, ConstantInt::get(Type::getInt32Ty(*llvmContext), 2 * i + 1),
+        "", currentBlock);
+    Value* code = new LoadInst(codePtr, "", currentBlock);
+    node->addIncoming(code, currentBlock);
+    BranchInst::Create(endBlock, currentBlock);
+
+    currentBlock = nextBlock;
+  }
+
+  // Once the cache is full, the call site is megamorphic and dispatches
+  // through the virtual table or the IMT without calling the runtime.
+  BasicBlock* missBlock = createBasicBlock("inline cache miss");
+  BasicBlock* megamorphicBlock = createBasicBlock("megamorphic call");
+  Value* full = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, lastVT,
+                             ConstantInt::get(wordType, 0), "");
+  BranchInst::Create(megamorphicBlock, missBlock, full, currentBlock);
+
+  currentBlock = megamorphicBlock;
+  PointerType* codeType = PointerType::getUnqual(Type::getInt8Ty(*llvmContext));
+  Value* code = Index != NULL ?
+    getInterfaceCode(args[0], Meth, Index, codeType) :
+    getVirtualCode(meth, args[0], codeType);
+  code = new PtrToIntInst(code, wordType, "", currentBlock);
+  node->addIncoming(code, currentBlock);
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = missBlock;
+  std::vector<Value*> Args;
+  Args.push_back(ConstantExpr::getIntToPtr(
+      ConstantInt::get(Type::getInt64Ty(*llvmContext), uint64_t(cache)),
+      intrinsics->ptrType));
+  Args.push_back(args[0]);
+  Args.push_back(Meth);
+  Args.push_back(Index != NULL ? Index : intrinsics->constantZero);
+  code = invoke(intrinsics->InlineCacheMissFunction, Args, "", currentBlock);
+  code = new PtrToIntInst(code, wordType, "", currentBlock);
+  node->addIncoming(code, currentBlock);
+  BranchInst::Create(endBlock, currentBlock);
+  currentBlock = endBlock;
+
+  Value* Func = new IntToPtrInst(node, LSI->getVirtualPtrType(), "",
+                                 currentBlock);
+  return invoke(Func, args, "", currentBlock);
+}
+
+Value* JavaJIT::invokeProfiledDirect(JavaMethod* target, Class* receiver,
+                                     JavaMethod* meth, Value* Meth,
+                                     Value* Index, InlineCache* cache,
+                                     std::vector<Value*>& args,
+                                     LLVMSignatureInfo* LSI) {
+  Class* customized =
+    TheCompiler->getMethodInfo(target)->isCustomizable ? receiver : NULL;
+  Value* VT = CallInst::Create(intrinsics->GetVTFunction, args[0], "",
+                               currentBlock);
+  Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, VT,
+                             TheCompiler->getVirtualTable(receiver->virtualVT),
+                             "");
+  BasicBlock* directBlock = createBasicBlock("profiled direct call");
+  BasicBlock* fallbackBlock = createBasicBlock("profiled fallback");
+  BasicBlock* endBlock = createBasicBlock("end profiled call");
+  BranchInst::Create(directBlock, fallbackBlock, test, currentBlock);
+
+  currentBlock = directBlock;
+  Value* direct = NULL;
+  if (shouldInline(target, false, cache)) {
+    direct = invokeInline(target, args, false);
+  } else {
+    direct = invoke(TheCompiler->getMethod(target, customized), args, "",
+                    currentBlock);
+  }
+  BasicBlock* directEnd = currentBlock;
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = fallbackBlock;
+  Value* fallback = invokeInlineCache(cache, meth, Meth, Index, args, LSI);
+  BasicBlock* fallbackEnd = currentBlock;
+  BranchInst::Create(endBlock, currentBlock);
+
+  currentBlock = endBlock;
+  if (direct == NULL || direct->getType() == Type::getVoidTy(*llvmContext)) {
+    return NULL;
+  }
+  PHINode* node = PHINode::Create(direct->getType(), 2, "", currentBlock);
+  node->addIncoming(direct, directEnd);
+  node->addIncoming(fallback, fallbackEnd);
+  return node;
+}
+
+JavaMethod* JavaJIT::getCHATarget(JavaMethod* meth, word_t*& guard) {
+  // The guards live in this process, they can not be emitted ahead of time.
+  if (TheCompiler->isStaticCompiling()) return NULL;
+  JavaMethod* target = ClassHierarchy::getUniqueImplementation(meth, guard);
+  if (target == NULL || isAbstract(target->access)) return NULL;
+  if (shouldInline(target, false)) return target;
+  bool needsInit = false;
+  if (TheCompiler->needsCallback(target, NULL, &needsInit)) return NULL;
+  return target;
+}
+
+Value* JavaJIT::invokeCHATarget(JavaMethod* target, word_t* guard,
+                                std::vector<Value*>& args,
+                                BasicBlock* invalidatedBlock) {
+  Constant* Guard = ConstantExpr::getIntToPtr(
+      ConstantInt::get(Type::getInt64Ty(*llvmContext), uint64_t(guard)),
+      PointerType::getUnqual(intrinsics->pointerSizeType));
+  Value* valid = new LoadInst(Guard, "", true, currentBlock);
+  Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, valid,
+                             ConstantInt::get(intrinsics->pointerSizeType, 0),
+                             "");
+  BasicBlock* directBlock = createBasicBlock("CHA direct call");
+  BranchInst::Create(directBlock, invalidatedBlock, test, currentBlock);
+  currentBlock = directBlock;
+
+  if (shouldInline(target, false)) {
+    return invokeInline(target, args, false);
+  }
+  return invoke(TheCompiler->getMethod(target, NULL), args, "", currentBlock);
+}
+
+Value* JavaJIT::invokeThroughVT(JavaMethod* meth, std::vector<Value*>& args,
+                                LLVMSignatureInfo* LSI) {
+  Value* Func = getVirtualCode(meth, args[0], LSI->getVirtualPtrType());
+  return invoke(Func, args, "", currentBlock);
+}
+
+Value* JavaJIT::joinCalls(Value* direct, BasicBlock* directEnd, Value* virt,
+                          BasicBlock* endBlock) {
+  BranchInst::Create(endBlock, directEnd);
+  BasicBlock* virtEnd = currentBlock;
+  BranchInst::Create(endBlock, currentBlock);
+  currentBlock = endBlock;
+  if (virt == NULL || virt->getType() == Type::getVoidTy(*llvmContext)) {
+    return NULL;
+  }
+  PHINode* node = PHINode::Create(virt->getType(), 2, "", currentBlock);
+  node->addIncoming(direct, directEnd);
+  node->addIncoming(virt, virtEnd);
+  return node;
+}
+
 llvm::Value* JavaJIT::getMutatorThreadPtr() {
   Value* FrameAddr = CallInst::Create(intrinsics->llvm_frameaddress,
                                      	intrinsics->constantZero, "", currentBlock);
@@ -370,6 +924,103 @@ static llvm::Function* GetNativeCallee(JavaLLVMCompiler* TheCompiler,
   return callee;
 }
 
+// The log of the size of the elements of a primitive array type, or -1 if
+// the type is not one.
+static sint32 getArrayLogSize(Typedef* type) {
+  const UTF8* name = type->keyName;
+  if (name->size != 2 || name->elements[0] != I_TAB) return -1;
+  switch (name->elements[1]) {
+    case I_BOOL: case I_BYTE: return 0;
+    case I_CHAR: case I_SHORT: return 1;
+    case I_INT: case I_FLOAT: return 2;
+    case I_LONG: case I_DOUBLE: return 3;
+    default: return -1;
+  }
+}
+
+// A critical native is a static, unsynchronized native method that only
+// takes and returns primitives and primitive arrays.
+static bool isCriticalNative(JavaMethod* meth) {
+  if (!isStatic(meth->access) || isSynchro(meth->access)) return false;
+  Signdef* signature = meth->getSignature();
+  if (!signature->getReturnType()->isPrimitive()) return false;
+  Typedef* const* arguments = signature->getArgumentsType();
+  for (uint32 i = 0; i < signature->nbArguments; ++i) {
+    if (!arguments[i]->isPrimitive() && getArrayLogSize(arguments[i]) < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+llvm::Function* JavaJIT::criticalNativeCompile(word_t natPtr,
+                                               const char* name) {
+  FunctionType* funcType = llvmFunction->getFunctionType();
+  Type* returnType = funcType->getReturnType();
+  Typedef* const* arguments =
+    compilingMethod->getSignature()->getArgumentsType();
+  currentBlock = createBasicBlock("start");
+
+  std::vector<Type*> nativeTypes;
+  std::vector<Value*> nativeArgs;
+  uint32 index = 0;
+  for (Function::arg_iterator i = llvmFunction->arg_begin(),
+       e = llvmFunction->arg_end(); i != e; ++i, ++index) {
+    if (arguments[index]->isPrimitive()) {
+      nativeTypes.push_back(i->getType());
+      nativeArgs.push_back(i);
+      continue;
+    }
+
+    // Give an array as its length and a pointer to its elements, or as 0
+    // and null if it is null.
+    BasicBlock* NotNull = createBasicBlock("");
+    BasicBlock* Next = createBasicBlock("");
+    BasicBlock* Null = currentBlock;
+    Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, i,
+                               intrinsics->JavaObjectNullConstant, "");
+    BranchInst::Create(Next, NotNull, test, currentBlock);
+
+    currentBlock = NotNull;
+    Value* size = arraySize(i);
+    Value* array = new BitCastInst(i, intrinsics->JavaArrayType, "",
+                                   currentBlock);
+    Value* indexes[2] = { intrinsics->constantZero,
+                          intrinsics->JavaArrayElementsOffsetConstant };
+    Value* elements = GetElementPtrInst::Create(array, indexes, "",
+                                                currentBlock);
+    elements = new BitCastInst(elements, intrinsics->ptrType, "",
+                               currentBlock);
+    BranchInst::Create(Next, currentBlock);
+
+    currentBlock = Next;
+    PHINode* length = PHINode::Create(size->getType(), 2, "", currentBlock);
+    length->addIncoming(Constant::getNullValue(size->getType()), Null);
+    length->addIncoming(size, NotNull);
+    PHINode* ptr = PHINode::Create(intrinsics->ptrType, 2, "", currentBlock);
+    ptr->addIncoming(intrinsics->constantPtrNull, Null);
+    ptr->addIncoming(elements, NotNull);
+
+    nativeTypes.push_back(size->getType());
+    nativeArgs.push_back(length);
+    nativeTypes.push_back(intrinsics->ptrType);
+    nativeArgs.push_back(ptr);
+  }
+
+  FunctionType* nativeType = FunctionType::get(returnType, nativeTypes, false);
+  Function* callee = Function::Create(nativeType,
+                                      GlobalValue::ExternalLinkage,
+                                      name, llvmFunction->getParent());
+  TheCompiler->setMethod(callee, (void*)natPtr, name);
+  Value* res = CallInst::Create(callee, nativeArgs, "", currentBlock);
+  if (returnType != Type::getVoidTy(*llvmContext)) {
+    ReturnInst::Create(*llvmContext, res, currentBlock);
+  } else {
+    ReturnInst::Create(*llvmContext, currentBlock);
+  }
+  return llvmFunction;
+}
+
 llvm::Function* JavaJIT::nativeCompile(word_t natPtr) {
   
   PRINT_DEBUG(JNJVM_COMPILE, 1, COLOR_NORMAL, "native compile %s.%s\n",
@@ -392,7 +1043,16 @@ llvm::Function* JavaJIT::nativeCompile(word_t natPtr) {
 
   vmkit::ThreadAllocator allocator;
   char* functionName = (char*)allocator.Allocate(
-      3 + JNI_NAME_PRE_LEN + ((mnlen + clen + mtlen) << 3));
+      3 + JNI_CRITICAL_NAME_PRE_LEN + ((mnlen + clen + mtlen) << 3));
+
+  // Critical natives do not call back into the VM: call them directly,
+  // without the JNI transition.
+  if (!natPtr && !TheCompiler->isStaticCompiling() &&
+      isCriticalNative(compilingMethod)) {
+    word_t critical = compilingClass->classLoader->criticalNativeLookup(
+        compilingMethod, functionName);
+    if (critical) return criticalNativeCompile(critical, functionName);
+  }
   
   if (!natPtr) {
     natPtr = compilingClass->classLoader->nativeLookup(compilingMethod, j3,
@@ -651,12 +1311,14 @@ void JavaJIT::monitorEnter(Value* obj) {
   gep.push_back(intrinsics->JavaObjectLockOffsetConstant);
   Value* lockPtr = GetElementPtrInst::Create(obj, gep, "", currentBlock);
   
-  Value* lock = new LoadInst(lockPtr, "", currentBlock);
-  lock = new PtrToIntInst(lock, intrinsics->pointerSizeType, "", currentBlock);
+  Value* header = new LoadInst(lockPtr, "", currentBlock);
+  header = new PtrToIntInst(header, intrinsics->pointerSizeType, "",
+                            currentBlock);
   Value* NonLockBitsMask = ConstantInt::get(intrinsics->pointerSizeType,
                                             vmkit::ThinLock::NonLockBitsMask);
 
-  lock = BinaryOperator::CreateAnd(lock, NonLockBitsMask, "", currentBlock);
+  Value* lock = BinaryOperator::CreateAnd(header, NonLockBitsMask, "",
+                                          currentBlock);
 
   lockPtr = new BitCastInst(lockPtr, 
                             PointerType::getUnqual(intrinsics->pointerSizeType),
@@ -667,6 +1329,60 @@ void JavaJIT::monitorEnter(Value* obj) {
   Value* newValMask = BinaryOperator::CreateOr(threadId, lock, "",
                                                currentBlock);
 
+  BasicBlock* OK = createBasicBlock("synchronize passed");
+
+  if (vmkit::ThinLock::supportsBiasing()) {
+    // If the object is biased towards this thread, increment the count
+    // with a plain store.
+    Value* biasedId = BinaryOperator::CreateOr(
+        threadId, ConstantInt::get(intrinsics->pointerSizeType,
+                                   vmkit::ThinLock::BiasedMask),
+        "", currentBlock);
+    Value* owner = BinaryOperator::CreateAnd(
+        header, ConstantInt::get(intrinsics->pointerSizeType,
+                                 ~(vmkit::ThinLock::NonLockBitsMask |
+                                   vmkit::ThinLock::ThinCountMask)),
+        "", currentBlock);
+    Value* ThinCountMask = ConstantInt::get(intrinsics->pointerSizeType,
+                                            vmkit::ThinLock::ThinCountMask);
+    Value* count = BinaryOperator::CreateAnd(header, ThinCountMask, "",
+                                             currentBlock);
+    Value* isBiased = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, owner,
+                                   biasedId, "");
+    Value* notFull = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, count,
+                                  ThinCountMask, "");
+    isBiased = BinaryOperator::CreateAnd(isBiased, notFull, "", currentBlock);
+
+    BasicBlock* Biased = createBasicBlock("biased synchronize");
+    BasicBlock* NotBiased = createBasicBlock("synchronize not biased");
+    BranchInst::Create(Biased, NotBiased, isBiased, currentBlock);
+
+    currentBlock = Biased;
+    Value* newHeader = BinaryOperator::CreateAdd(
+        header, ConstantInt::get(intrinsics->pointerSizeType,
+                                 vmkit::ThinLock::ThinCountAdd),
+        "", currentBlock);
+    new StoreInst(newHeader, lockPtr, currentBlock);
+    BranchInst::Create(OK, currentBlock);
+
+    // Otherwise, an unlocked object that was never revoked gets biased
+    // towards this thread.
+    currentBlock = NotBiased;
+    Value* unbiasable = BinaryOperator::CreateAnd(
+        lock, ConstantInt::get(intrinsics->pointerSizeType,
+                               vmkit::ThinLock::UnbiasableMask),
+        "", currentBlock);
+    unbiasable = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, unbiasable,
+                              intrinsics->constantPtrZero, "");
+    Value* bias = SelectInst::Create(
+        unbiasable, intrinsics->constantPtrZero,
+        ConstantInt::get(intrinsics->pointerSizeType,
+                         vmkit::ThinLock::BiasedMask |
+                         vmkit::ThinLock::ThinCountAdd),
+        "", currentBlock);
+    newValMask = BinaryOperator::CreateOr(newValMask, bias, "", currentBlock);
+  }
+
   // Do the atomic compare and swap.
   Value* atomic = new AtomicCmpXchgInst(
       lockPtr, lock, newValMask, SequentiallyConsistent, CrossThread,
@@ -675,7 +1391,6 @@ void JavaJIT::monitorEnter(Value* obj) {
   Value* cmp = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, atomic,
                             lock, "");
   
-  BasicBlock* OK = createBasicBlock("synchronize passed");
   BasicBlock* NotOK = createBasicBlock("synchronize did not pass");
 
   BranchInst::Create(OK, NotOK, cmp, currentBlock);
@@ -688,7 +1403,7 @@ void JavaJIT::monitorEnter(Value* obj) {
   currentBlock = OK;
 }
 
-void JavaJIT::monitorExit(Value* obj) {
+void JavaJIT::monitorExit(Value* obj, bool mayThrow) {
   std::vector<Value*> gep;
   gep.push_back(intrinsics->constantZero);
   gep.push_back(intrinsics->JavaObjectLockOffsetConstant);
@@ -707,6 +1422,45 @@ void JavaJIT::monitorExit(Value* obj) {
   threadId = new PtrToIntInst(threadId, intrinsics->pointerSizeType, "",
                               currentBlock);
   
+  BasicBlock* OK = createBasicBlock("unsynchronize passed");
+
+  if (vmkit::ThinLock::supportsBiasing()) {
+    // If the object is biased towards this thread, decrement the count
+    // with a plain store.
+    Value* biasedId = BinaryOperator::CreateOr(
+        threadId, ConstantInt::get(intrinsics->pointerSizeType,
+                                   vmkit::ThinLock::BiasedMask),
+        "", currentBlock);
+    Value* owner = BinaryOperator::CreateAnd(
+        lock, ConstantInt::get(intrinsics->pointerSizeType,
+                               ~(vmkit::ThinLock::NonLockBitsMask |
+                                 vmkit::ThinLock::ThinCountMask)),
+        "", currentBlock);
+    Value* count = BinaryOperator::CreateAnd(
+        lock, ConstantInt::get(intrinsics->pointerSizeType,
+                               vmkit::ThinLock::ThinCountMask),
+        "", currentBlock);
+    Value* isBiased = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, owner,
+                                   biasedId, "");
+    Value* held = new ICmpInst(*currentBlock, ICmpInst::ICMP_NE, count,
+                               intrinsics->constantPtrZero, "");
+    isBiased = BinaryOperator::CreateAnd(isBiased, held, "", currentBlock);
+
+    BasicBlock* Biased = createBasicBlock("biased unsynchronize");
+    BasicBlock* NotBiased = createBasicBlock("unsynchronize not biased");
+    BranchInst::Create(Biased, NotBiased, isBiased, currentBlock);
+
+    currentBlock = Biased;
+    Value* newHeader = BinaryOperator::CreateSub(
+        lock, ConstantInt::get(intrinsics->pointerSizeType,
+                               vmkit::ThinLock::ThinCountAdd),
+        "", currentBlock);
+    new StoreInst(newHeader, lockPtr, currentBlock);
+    BranchInst::Create(OK, currentBlock);
+
+    currentBlock = NotBiased;
+  }
+
   Value* oldValMask = BinaryOperator::CreateOr(threadId, lockedMask, "",
                                                currentBlock);
 
@@ -723,14 +1477,17 @@ void JavaJIT::monitorExit(Value* obj) {
   Value* cmp = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, atomic,
                             oldValMask, "");
   
-  BasicBlock* OK = createBasicBlock("unsynchronize passed");
   BasicBlock* NotOK = createBasicBlock("unsynchronize did not pass");
 
   BranchInst::Create(OK, NotOK, cmp, currentBlock);
 
   // The atomic cas did not work.
   currentBlock = NotOK;
-  CallInst::Create(intrinsics->ReleaseObjectFunction, obj, "", currentBlock);
+  if (mayThrow) {
+    invoke(intrinsics->ReleaseObjectFunction, obj, "", currentBlock);
+  } else {
+    CallInst::Create(intrinsics->ReleaseObjectFunction, obj, "", currentBlock);
+  }
   BranchInst::Create(OK, currentBlock);
 
   currentBlock = OK;
@@ -802,7 +1559,8 @@ static void removeUnusedObjects(std::vector<AllocaInst*>& objects,
 
 Instruction* JavaJIT::inlineCompile(BasicBlock*& curBB,
                                     BasicBlock* endExBlock,
-                                    std::vector<Value*>& args) {
+                                    std::vector<Value*>& args,
+                                    bool explicitNullChecks) {
   Attribut* codeAtt = compilingMethod->lookupAttribut(Attribut::codeAttribut);
   Reader reader(codeAtt, compilingClass->bytes);
   uint16 maxStack = reader.readU2();
@@ -824,6 +1582,7 @@ Instruction* JavaJIT::inlineCompile(BasicBlock*& curBB,
   memset(opcodeInfos, 0, codeLen * sizeof(Opinfo));
   for (uint32 i = 0; i < codeLen; ++i) {
     opcodeInfos[i].exceptionBlock = endExBlock;
+    opcodeInfos[i].explicitNullCheck = explicitNullChecks;
   }
   
   BasicBlock* firstBB = llvmFunction->begin();
@@ -932,7 +1691,7 @@ Instruction* JavaJIT::inlineCompile(BasicBlock*& curBB,
     }
   }
   
-  nbHandlers = readExceptionTable(reader, codeLen);
+  nbHandlers += readExceptionTable(reader, codeLen);
   
   reader.cursor = start;
   exploreOpcodes(reader, codeLen);
@@ -1006,8 +1765,12 @@ llvm::Function* JavaJIT::javaCompile() {
 
   opcodeInfos = new Opinfo[codeLen];
   memset(opcodeInfos, 0, codeLen * sizeof(Opinfo));
+  // The lock of a synchronized method is released by the exception
+  // destination of the method.
+  bool synchro = isSynchro(compilingMethod->access);
   for (uint32 i = 0; i < codeLen; ++i) {
     opcodeInfos[i].exceptionBlock = endExceptionBlock;
+    opcodeInfos[i].explicitNullCheck = synchro;
   }
 
   Instruction* returnValue = NULL;
@@ -1057,7 +1820,11 @@ llvm::Function* JavaJIT::javaCompile() {
   Typedef* const* arguments = sign->getArgumentsType();
   uint32 type = 0;
 
-  if (isVirtual(compilingMethod->access)) {
+  if (osrIndex >= 0) {
+    // The arguments are in the locals of the replaced frame.
+    loadOSRLocals(i);
+    max = 0;
+  } else if (isVirtual(compilingMethod->access)) {
     Instruction* V = new StoreInst(i, objectLocals[0], false, currentBlock);
     addHighLevelType(V, compilingClass);
     ++i;
@@ -1148,6 +1915,12 @@ llvm::Function* JavaJIT::javaCompile() {
     currentBlock = noStackOverflow;
   }
 
+  if (osrIndex >= 0) {
+    // Enter the method at the loop header. The code before it is dead.
+    BranchInst::Create(opcodeInfos[osrIndex].newBlock, currentBlock);
+    currentBlock = createBasicBlock("before OSR entry");
+  }
+
   reader.cursor = start;
   compileOpcodes(reader, codeLen);
   
@@ -1343,11 +2116,14 @@ void JavaJIT::loadConstant(uint16 index) {
 
 void JavaJIT::JITVerifyNull(Value* obj) {
   if (TheCompiler->hasExceptionsEnabled()) {
-    if (nbHandlers == 0 && vmkit::System::SupportsHardwareNullCheck()) {
-      Value* indexes[2] = { intrinsics->constantZero, intrinsics->constantZero };
-      Value* VTPtr = GetElementPtrInst::Create(obj, indexes, "", currentBlock);
-      Instruction* VT = new LoadInst(VTPtr, "", true, currentBlock);
-      VT->setDebugLoc(DebugLoc::get(currentBytecodeIndex, 1, DbgSubprogram));
+    if (!opcodeInfos[currentBytecodeIndex].explicitNullCheck &&
+        vmkit::System::SupportsHardwareNullCheck()) {
+      // The check is only read from memory: the optimizers merge the
+      // checks of the same object and move them as long as they do not
+      // cross a write. LowerConstantCalls turns it into a faulting load.
+      Instruction* check = CallInst::Create(intrinsics->NullCheckFunction, obj,
+                                            "", currentBlock);
+      check->setDebugLoc(DebugLoc::get(currentBytecodeIndex, 1, DbgSubprogram));
     } else {
       Constant* zero = intrinsics->JavaObjectNullConstant;
       Value* test = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, obj, zero, "");
@@ -1570,6 +2346,60 @@ Instruction* JavaJIT::lowerDoubleOps(const UTF8* name,
   return NULL;
 }
 
+Instruction* JavaJIT::lowerArraysOps(const UTF8* name, Signdef* signature,
+                                     std::vector<Value*>& args) {
+  JnjvmBootstrapLoader* loader = compilingClass->classLoader->bootstrapLoader;
+  Typedef* const* arguments = signature->getArgumentsType();
+  if (signature->nbArguments != 2) return NULL;
+  sint32 logSize = getArrayLogSize(arguments[0]);
+  if (logSize < 0) return NULL;
+  Value* LogSize = ConstantInt::get(Type::getInt32Ty(*llvmContext), logSize);
+  Type* Int64 = Type::getInt64Ty(*llvmContext);
+
+  if (name->equals(loader->fill) && arguments[1]->isPrimitive()) {
+    JITVerifyNull(args[0]);
+    Value* value = args[1];
+    if (value->getType()->isFloatTy()) {
+      value = new BitCastInst(value, Type::getInt32Ty(*llvmContext), "",
+                              currentBlock);
+    } else if (value->getType()->isDoubleTy()) {
+      value = new BitCastInst(value, Int64, "", currentBlock);
+    }
+    if (value->getType() != Int64) {
+      value = new ZExtInst(value, Int64, "", currentBlock);
+    }
+    Value* Args[3] = { args[0], value, LogSize };
+    return CallInst::Create(intrinsics->ArrayFillFunction, Args, "",
+                            currentBlock);
+  } else if (name->equals(loader->equals) &&
+             arguments[1]->keyName->equals(arguments[0]->keyName) &&
+             arguments[0]->keyName->elements[1] != I_FLOAT &&
+             arguments[0]->keyName->elements[1] != I_DOUBLE) {
+    // Floating point arrays compare their elements as Float.equals does,
+    // which is not a comparison of the bits.
+    Value* Args[3] = { args[0], args[1], LogSize };
+    return CallInst::Create(intrinsics->ArrayEqualsFunction, Args, "",
+                            currentBlock);
+  }
+  return NULL;
+}
+
+Function* JavaJIT::getStringIntrinsic(JavaMethod* meth, Signdef* signature) {
+  if (meth->classDef != upcalls->newString) return NULL;
+  JnjvmBootstrapLoader* loader = compilingClass->classLoader->bootstrapLoader;
+  Typedef* const* arguments = signature->getArgumentsType();
+  if (meth->name->equals(loader->hashCode) && signature->nbArguments == 0) {
+    return intrinsics->StringHashCodeFunction;
+  } else if (meth->name->equals(loader->equals) &&
+             signature->nbArguments == 1 && !arguments[0]->isPrimitive()) {
+    return intrinsics->StringEqualsFunction;
+  } else if (meth->name->equals(loader->indexOf) &&
+             signature->nbArguments == 1 && arguments[0]->isInt()) {
+    return intrinsics->StringIndexOfFunction;
+  }
+  return NULL;
+}
+
 
 Instruction* JavaJIT::invokeInline(JavaMethod* meth, 
                                    std::vector<Value*>& args,
@@ -1580,6 +2410,10 @@ Instruction* JavaJIT::invokeInline(JavaMethod* meth,
   jit.inlineMethods[meth] = true;
   jit.inlining = true;
   jit.DbgSubprogram = DbgSubprogram;
+  jit.inlinedSize = inlinedSize;
+  // Exceptions thrown by the inlined code go to the exception destination of
+  // the call site when this method handles exceptions.
+  jit.nbHandlers = nbHandlers;
 #if DEBUG
   static int inlineNb = 0;
   fprintf(stderr, "inline compile %d %s.%s%s from %s.%s (%d)\n", inlineNb++,
@@ -1591,9 +2425,15 @@ Instruction* JavaJIT::invokeInline(JavaMethod* meth,
               customized);
 #endif
   
-  Instruction* ret = jit.inlineCompile(currentBlock, 
-                                       currentExceptionBlock, args);
+  Instruction* ret = jit.inlineCompile(
+      currentBlock, currentExceptionBlock, args,
+      opcodeInfos[currentBytecodeIndex].explicitNullCheck);
   inlineMethods[meth] = false;
+  // The size of the method already includes the callees it inlined.
+  inlinedSize += meth->inlineCodeSize;
+  // The handlers of the inlined method forward the exceptions they do not
+  // catch to this method, which must then check for pending exceptions.
+  nbHandlers = jit.nbHandlers;
   return ret;
 }
 
@@ -1640,7 +2480,7 @@ void JavaJIT::invokeSpecial(uint16 index) {
   }
 
   llvm::Instruction* val = 0;
-  if (meth && canBeInlined(meth, false)) {
+  if (meth && shouldInline(meth, false)) {
     val = invokeInline(meth, args, false);
   } else {
     val = invoke(func, args, "", currentBlock);
@@ -1704,14 +2544,23 @@ void JavaJIT::invokeStatic(uint16 index) {
 
   if (className->equals(loader->mathName)) {
     val = lowerMathOps(name, args);
-  } else if (className->equals(loader->VMFloatName)) {
+  } else if (className->equals(loader->VMFloatName) ||
+             className->equals(loader->floatName)) {
     val = lowerFloatOps(name, args);
-  } else if (className->equals(loader->VMDoubleName)) {
+  } else if (className->equals(loader->VMDoubleName) ||
+             className->equals(loader->doubleName)) {
     val = lowerDoubleOps(name, args);
+  } else if (className->equals(loader->arraysName)) {
+    val = lowerArraysOps(name, signature, args);
+  } else if (className->equals(loader->systemName) ||
+             className->equals(loader->VMSystemName)) {
+    if (name->equals(loader->nanoTime) && signature->nbArguments == 0) {
+      val = CallInst::Create(intrinsics->NanoTimeFunction, "", currentBlock);
+    }
   }
     
   if (val == NULL) {
-    if (meth != NULL && canBeInlined(meth, false)) {
+    if (meth != NULL && shouldInline(meth, false)) {
       val = invokeInline(meth, args, false);
     } else {
       val = invoke(func, args, "", currentBlock);
@@ -1859,6 +2708,43 @@ void JavaJIT::invokeNew(uint16 index) {
 
   addHighLevelType(val, cl ? cl : upcalls->OfObject);
   Instruction* res = new BitCastInst(val, intrinsics->JavaObjectType, "", currentBlock);
+
+  if (vmkit::ThinLock::supportsBiasing()) {
+    // The instances of a class whose biases were often revoked start
+    // unbiasable.
+    Value* ClassPtr = cl ? TheCompiler->getNativeClass(cl) : Cl;
+    if (ClassPtr->getType() != intrinsics->JavaClassType) {
+      ClassPtr = new BitCastInst(ClassPtr, intrinsics->JavaClassType, "",
+                                 currentBlock);
+    }
+    std::vector<Value*> indexes;
+    indexes.push_back(intrinsics->constantZero);
+    indexes.push_back(intrinsics->OffsetBiasRevocationsInClassConstant);
+    Value* revocations = GetElementPtrInst::Create(ClassPtr, indexes, "",
+                                                   currentBlock);
+    revocations = new LoadInst(revocations, "", currentBlock);
+    Value* unbiasable = new ICmpInst(
+        *currentBlock, ICmpInst::ICMP_UGE, revocations,
+        ConstantInt::get(Type::getInt32Ty(*llvmContext),
+                         Class::BiasRevocationThreshold), "");
+    Value* bits = SelectInst::Create(
+        unbiasable,
+        ConstantInt::get(intrinsics->pointerSizeType,
+                         vmkit::ThinLock::UnbiasableMask),
+        intrinsics->constantPtrZero, "", currentBlock);
+
+    std::vector<Value*> gep;
+    gep.push_back(intrinsics->constantZero);
+    gep.push_back(intrinsics->JavaObjectLockOffsetConstant);
+    Value* lockPtr = GetElementPtrInst::Create(res, gep, "", currentBlock);
+    lockPtr = new BitCastInst(lockPtr,
+                              PointerType::getUnqual(intrinsics->pointerSizeType),
+                              "", currentBlock);
+    Value* header = new LoadInst(lockPtr, "", currentBlock);
+    header = BinaryOperator::CreateOr(header, bits, "", currentBlock);
+    new StoreInst(header, lockPtr, currentBlock);
+  }
+
   push(res, false, cl ? cl : upcalls->OfObject);
 
   // Make sure to add the object to the finalization list after it has been
@@ -2176,123 +3062,49 @@ void JavaJIT::invokeInterface(uint16 index) {
                              intrinsics->JavaMethodType, 0, true);
   }
 
-  uint32_t tableIndex = InterfaceMethodTable::getIndex(name, signature->keyName);
-  Constant* Index = ConstantInt::get(Type::getInt32Ty(*llvmContext),
-                                     tableIndex);
+  uint32_t selector =
+    InterfaceMethodTable::getSelector(name, signature->keyName);
+  Constant* Index = ConstantInt::get(Type::getInt32Ty(*llvmContext), selector);
   Value* targetObject = getTarget(signature);
   targetObject = new LoadInst(
           targetObject, "", false, currentBlock);
   if (!thisReference) JITVerifyNull(targetObject);
-  // TODO: The following code needs more testing.
-#if 0
-  BasicBlock* endBlock = createBasicBlock("end interface invoke");
-  PHINode * node = PHINode::Create(virtualPtrType, "", endBlock);
-
-  BasicBlock* label_bb = createBasicBlock("bb");
-  BasicBlock* label_bb4 = createBasicBlock("bb4");
-  BasicBlock* label_bb6 = createBasicBlock("bb6");
-  BasicBlock* label_bb7 = createBasicBlock("bb7");
-    
-  // Block entry (label_entry)
-  Value* VT = CallInst::Create(intrinsics->GetVTFunction, targetObject, "",
-                               currentBlock);
-  Value* IMT = CallInst::Create(intrinsics->GetIMTFunction, VT, "",
-                                currentBlock);
-
-
-  Value* indices[2] = { intrinsics->constantZero, Index };
-  Instruction* ptr_18 = GetElementPtrInst::Create(IMT, indices, "",
-                                                  currentBlock);
-  Instruction* int32_19 = new LoadInst(ptr_18, "", false, currentBlock);
-  int32_19 = new PtrToIntInst(int32_19, intrinsics->pointerSizeType, "",
-                              currentBlock);
-  Value* one = ConstantInt::get(intrinsics->pointerSizeType, 1);
-  Value* zero = ConstantInt::get(intrinsics->pointerSizeType, 0);
-  BinaryOperator* int32_20 = BinaryOperator::Create(Instruction::And, int32_19,
-                                                    one, "", currentBlock);
-  ICmpInst* int1_toBool = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ,
-                                       int32_20, zero, "toBool");
-  BranchInst::Create(label_bb, label_bb4, int1_toBool, currentBlock);
-    
-  // Block bb (label_bb)
-  currentBlock = label_bb;
-  CastInst* ptr_22 = new IntToPtrInst(int32_19, virtualPtrType, "", currentBlock);
-  
-  node->addIncoming(ptr_22, currentBlock);
-  BranchInst::Create(endBlock, currentBlock);
-    
-  // Block bb4 (label_bb4)
-  currentBlock = label_bb4;
-  Constant* MinusTwo = ConstantInt::get(intrinsics->pointerSizeType, -2);
-  BinaryOperator* int32_25 = BinaryOperator::Create(Instruction::And, int32_19,
-                                                    MinusTwo, "", currentBlock);
-  PointerType* Ty = PointerType::getUnqual(intrinsics->JavaMethodType);
-  CastInst* ptr_26 = new IntToPtrInst(int32_25, Ty, "", currentBlock);
-  LoadInst* int32_27 = new LoadInst(ptr_26, "", false, currentBlock);
-  ICmpInst* int1_28 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, int32_27,
-                                   Meth, "");
-  BranchInst::Create(label_bb6, label_bb7, int1_28, currentBlock);
-    
-  // Block bb6 (label_bb6)
-  currentBlock = label_bb6;
-  PHINode* ptr_table_0_lcssa = PHINode::Create(Ty, 2, "table.0.lcssa",
-                                               currentBlock);
-  ptr_table_0_lcssa->reserveOperandSpace(2);
-  ptr_table_0_lcssa->addIncoming(ptr_26, label_bb4);
-   
-  GetElementPtrInst* ptr_31 = GetElementPtrInst::Create(ptr_table_0_lcssa,
-                                                        intrinsics->constantOne, "",
-                                                        currentBlock);
-
-  LoadInst* int32_32 = new LoadInst(ptr_31, "", false, currentBlock);
-  CastInst* ptr_33 = new BitCastInst(int32_32, virtualPtrType, "",
-                                     currentBlock);
-  node->addIncoming(ptr_33, currentBlock);
-
-  BranchInst::Create(endBlock, currentBlock);
-    
-  // Block bb7 (label_bb7)
-  currentBlock = label_bb7;
-  PHINode* int32_indvar = PHINode::Create(Type::getInt32Ty(*llvmContext),
-                                          "indvar", currentBlock);
-  int32_indvar->reserveOperandSpace(2);
-  int32_indvar->addIncoming(intrinsics->constantZero, label_bb4);
-    
-  BinaryOperator* int32_table_010_rec =
-    BinaryOperator::Create(Instruction::Shl, int32_indvar, intrinsics->constantOne,
-                           "table.010.rec", currentBlock);
-
-  BinaryOperator* int32__rec =
-    BinaryOperator::Create(Instruction::Add, int32_table_010_rec,
-                           intrinsics->constantTwo, ".rec", currentBlock);
-  GetElementPtrInst* ptr_37 = GetElementPtrInst::Create(ptr_26, int32__rec, "",
-                                                        currentBlock);
-  LoadInst* int32_38 = new LoadInst(ptr_37, "", false, currentBlock);
-  ICmpInst* int1_39 = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, int32_38,
-                                   Meth, "");
-  BinaryOperator* int32_indvar_next =
-    BinaryOperator::Create(Instruction::Add, int32_indvar, intrinsics->constantOne,
-                           "indvar.next", currentBlock);
-  BranchInst::Create(label_bb6, label_bb7, int1_39, currentBlock);
-  
-  int32_indvar->addIncoming(int32_indvar_next, currentBlock);
-  ptr_table_0_lcssa->addIncoming(ptr_37, currentBlock);
-      
-  currentBlock = endBlock;
-#else
-  std::vector<Value*> Args;
-  Args.push_back(targetObject);
-  Args.push_back(Meth);
-  Args.push_back(Index);
-  Value* node = invoke(intrinsics->ResolveInterfaceFunction,
-                       Args, "invokeinterface", currentBlock);
-  node = new BitCastInst(node, virtualPtrType, "", currentBlock);
-#endif
 
   std::vector<Value*> args; // size = [signature->nbIn + 3];
   FunctionType::param_iterator it  = virtualType->param_end();
   makeArgs(it, index, args, signature->nbArguments + 1);
-  Value* ret = invoke(node, args, "", currentBlock);
+
+  word_t* guard = NULL;
+  JavaMethod* chaTarget = meth ? getCHATarget(meth, guard) : NULL;
+  Value* direct = NULL;
+  BasicBlock* directEnd = NULL;
+  BasicBlock* endBlock = NULL;
+  if (chaTarget != NULL) {
+    BasicBlock* invalidatedBlock = createBasicBlock("CHA invalidated");
+    endBlock = createBasicBlock("end CHA call");
+    direct = invokeCHATarget(chaTarget, guard, args, invalidatedBlock);
+    directEnd = currentBlock;
+    currentBlock = invalidatedBlock;
+  }
+
+  InlineCache* cache = getInlineCache();
+  Value* ret = NULL;
+  if (cache != NULL && !cache->isMegamorphic()) {
+    Class* receiver = NULL;
+    JavaMethod* target = getProfiledTarget(cache, meth, receiver);
+    if (target != NULL) {
+      ret = invokeProfiledDirect(target, receiver, NULL, Meth, Index, cache,
+                                 args, LSI);
+    } else {
+      ret = invokeInlineCache(cache, NULL, Meth, Index, args, LSI);
+    }
+  } else {
+    Value* Func = getInterfaceCode(args[0], Meth, Index, virtualPtrType);
+    ret = invoke(Func, args, "", currentBlock);
+  }
+  if (endBlock != NULL) {
+    ret = joinCalls(direct, directEnd, ret, endBlock);
+  }
   if (retType != Type::getVoidTy(*llvmContext)) {
     if (ret->getType() == intrinsics->JavaObjectType) {
       JnjvmClassLoader* JCL = compilingClass->classLoader;
@@ -2475,10 +3287,14 @@ unsigned JavaJIT::readExceptionTable(Reader& reader, uint32 codeLen) {
     // handler to the test block of the handler. If an instruction already has
     // a handler and thus is not the synchronize or regular end handler block,
     // leave it as-is.
+    // If the handler may catch a NullPointerException, the null checks in
+    // its range must branch to it.
+    bool catchesNull = upcalls->NullPointerException->isSubclassOf(ex->catchClass);
     for (uint16 i = ex->startpc; i < ex->endpc; ++i) {
       if (opcodeInfos[i].exceptionBlock == endExceptionBlock) {
         opcodeInfos[i].exceptionBlock = ex->tester;
       }
+      if (catchesNull) opcodeInfos[i].explicitNullCheck = true;
     }
 
     // If the handler pc does not already have a block, create a new one.
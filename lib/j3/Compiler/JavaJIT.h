@@ -67,6 +67,13 @@ struct Opinfo {
 
   /// backEdge - If this block is a back edge.
   bool backEdge;
+
+  /// explicitNullCheck - If a NullPointerException thrown by the instruction
+  /// may be caught, or require cleanup, in the method. Null checks of the
+  /// instruction can then not rely on the hardware: a fault unwinds
+  /// directly to the caller.
+  ///
+  bool explicitNullCheck;
 };
 
 /// JavaJIT - The compilation engine of J3. Parses the bycode and returns
@@ -99,6 +106,12 @@ public:
     overridesThis = false;
     nbHandlers = 0;
     jmpBuffer = NULL;
+    inlinedSize = 0;
+    sawRecursion = false;
+    sawUnresolved = false;
+    osrIndex = -1;
+    osrBuffer = NULL;
+    osrCount = NULL;
   }
 
   /// javaCompile - Compile the Java method.
@@ -106,6 +119,10 @@ public:
   
   /// nativeCompile - Compile the native method.
   llvm::Function* nativeCompile(word_t natPtr = 0);
+
+  /// criticalNativeCompile - Compile the native method as a direct call to
+  /// its critical version.
+  llvm::Function* criticalNativeCompile(word_t natPtr, const char* name);
   
   /// isCustomizable - Whether we found the method to be customizable.
   bool isCustomizable;
@@ -113,6 +130,11 @@ public:
   // The number of handlers in that method.
   uint32_t nbHandlers;
 
+  /// osrIndex - If compiling the version of the method entered by on-stack
+  /// replacement, the bytecode index of the loop header where it is
+  /// entered. -1 otherwise.
+  sint32 osrIndex;
+
 private:
   /// Whether the method overrides 'this'.
   bool overridesThis;
@@ -207,10 +229,12 @@ private:
 
   /// inlineCompile - Parse the method and start its LLVM representation
   /// at curBB. endExBlock is the exception destination. args is the
-  /// arguments of the method.
+  /// arguments of the method. explicitNullChecks tells if endExBlock may
+  /// catch a NullPointerException.
   llvm::Instruction* inlineCompile(llvm::BasicBlock*& curBB,
                                    llvm::BasicBlock* endExBlock,
-                                   std::vector<llvm::Value*>& args);
+                                   std::vector<llvm::Value*>& args,
+                                   bool explicitNullChecks);
 
 
   /// inlineMethods - Methods that are currently being inlined. The JIT
@@ -220,9 +244,40 @@ private:
   /// inlining - Are we JITting a method inline?
   bool inlining;
   
-  /// canBeInlined - Can this method's body be inlined?
+  /// canBeInlined - Can this method's body be inlined? The answer for
+  /// uncustomized methods is cached in the method.
   bool canBeInlined(JavaMethod* meth, bool customizing);
 
+  /// shouldInline - Can this method's body be inlined, and does it fit in
+  /// the budget of the method being compiled? Hot call sites whose inline
+  /// cache only saw one receiver type accept bigger methods.
+  bool shouldInline(JavaMethod* meth, bool customizing,
+                    InlineCache* cache = NULL);
+
+  /// MaxInlineSize - Maximum bytecode length of a method inlined at a call
+  /// site without profile.
+  static const uint32 MaxInlineSize = 35;
+
+  /// MaxHotInlineSize - Maximum bytecode length of a method inlined at a
+  /// hot monomorphic call site.
+  static const uint32 MaxHotInlineSize = 325;
+
+  /// InlineBudget - Maximum bytecode length inlined in one compiled method.
+  static const uint32 InlineBudget = 2000;
+
+  /// inlinedSize - The bytecode length inlined so far in the method being
+  /// compiled, including the inlined methods of the inlined methods.
+  uint32 inlinedSize;
+
+  /// sawRecursion - Did the analysis for inlining refuse a method because it
+  /// was already being inlined? The answer is then not cached.
+  bool sawRecursion;
+
+  /// sawUnresolved - Did the analysis for inlining refuse a method because a
+  /// field, method or class it uses is not resolved or initialised yet? The
+  /// answer is then not cached either.
+  bool sawUnresolved;
+
   /// callsStackWalker - Is the method calling a stack walker method? If it is,
   /// then this method can not be inlined.
   bool callsStackWalker;
@@ -249,7 +304,9 @@ private:
 
 //===------------------------- Runtime exceptions -------------------------===//
   
-  /// JITVerifyNull - Insert a null pointer check in the LLVM code.
+  /// JITVerifyNull - Insert a null pointer check in the LLVM code. The check
+  /// is implicit when the hardware supports it and the exception would not
+  /// be caught in the method.
   void JITVerifyNull(llvm::Value* obj);
   
   
@@ -450,7 +507,9 @@ private:
   void monitorEnter(llvm::Value* obj);
   
   /// monitorExit - Emit synchronization code to release the lock of the value.
-  void monitorExit(llvm::Value* obj);
+  /// If mayThrow is true, the lock may not be held by the thread, and the
+  /// runtime throws an IllegalMonitorStateException.
+  void monitorExit(llvm::Value* obj, bool mayThrow = false);
 
 //===----------------------- Java field accesses  -------------------------===//
 
@@ -510,6 +569,77 @@ private:
   /// invokeInterface - Invoke a Java interface method.
   void invokeInterface(uint16 index);
 
+  /// getInlineCache - Get the inline cache of the current call site, or null
+  /// if the compiler does not use inline caches.
+  InlineCache* getInlineCache();
+
+  /// getTypeCheckMisses - Get the miss counter of the current type check,
+  /// or null if the compiler does not profile type checks.
+  word_t* getTypeCheckMisses();
+
+  /// isSecondaryType - Check if VT is a subtype of the secondary type
+  /// otherVT. The cache of VT is compared inline, the secondary types are
+  /// scanned out of line.
+  llvm::Value* isSecondaryType(llvm::Value* VT, llvm::Value* otherVT);
+
+  /// getProfiledTarget - If the inline cache shows a hot call site with a
+  /// single receiver type, return the method called for that type, and the
+  /// receiver class.
+  JavaMethod* getProfiledTarget(InlineCache* cache, JavaMethod* meth,
+                                Class*& receiver);
+
+  /// getVirtualCode - Load the code of the method from the virtual table of
+  /// the object.
+  llvm::Value* getVirtualCode(JavaMethod* meth, llvm::Value* obj,
+                              llvm::PointerType* codeType);
+
+  /// getInterfaceCode - Load the code of the interface method with the
+  /// given selector from the IMT of the object. Only selectors shared by
+  /// different methods call the runtime.
+  llvm::Value* getInterfaceCode(llvm::Value* obj, llvm::Value* Meth,
+                                llvm::Value* Index,
+                                llvm::PointerType* codeType);
+
+  /// invokeInlineCache - Dispatch a virtual or interface call through the
+  /// inline cache of the call site, falling back to the runtime on a miss.
+  /// Index is the selector of an interface call, or null for a virtual
+  /// call of meth. Once the cache is full, misses dispatch through the
+  /// virtual table or the IMT.
+  llvm::Value* invokeInlineCache(InlineCache* cache, JavaMethod* meth,
+                                 llvm::Value* Meth, llvm::Value* Index,
+                                 std::vector<llvm::Value*>& args,
+                                 LLVMSignatureInfo* LSI);
+
+  /// invokeProfiledDirect - Call the profiled target directly when the
+  /// receiver's VT is the cached one, and use the inline cache otherwise.
+  llvm::Value* invokeProfiledDirect(JavaMethod* target, Class* receiver,
+                                    JavaMethod* meth, llvm::Value* Meth,
+                                    llvm::Value* Index, InlineCache* cache,
+                                    std::vector<llvm::Value*>& args,
+                                    LLVMSignatureInfo* LSI);
+
+  /// getCHATarget - If the class hierarchy shows a single implementation of
+  /// the method that can be called directly or inlined, return it with the
+  /// guard of the answer.
+  JavaMethod* getCHATarget(JavaMethod* meth, word_t*& guard);
+
+  /// invokeCHATarget - Branch to the given block if the guard has been
+  /// cleared, and otherwise call or inline the target.
+  llvm::Value* invokeCHATarget(JavaMethod* target, word_t* guard,
+                               std::vector<llvm::Value*>& args,
+                               llvm::BasicBlock* invalidatedBlock);
+
+  /// invokeThroughVT - Call the method through the virtual table of the
+  /// receiver.
+  llvm::Value* invokeThroughVT(JavaMethod* meth,
+                               std::vector<llvm::Value*>& args,
+                               LLVMSignatureInfo* LSI);
+
+  /// joinCalls - Join the results of the direct and virtual paths of a call
+  /// site in the given block.
+  llvm::Value* joinCalls(llvm::Value* direct, llvm::BasicBlock* directEnd,
+                         llvm::Value* virt, llvm::BasicBlock* endBlock);
+
   /// invokeSpecial - Invoke an instance Java method directly.
   void invokeSpecial(uint16 index);
 
@@ -531,6 +661,15 @@ private:
                                    std::vector<llvm::Value*>& args);
   llvm::Instruction* lowerDoubleOps(const UTF8* name, 
                                     std::vector<llvm::Value*>& args);
+
+  /// lowerArraysOps - Map the Arrays.fill and Arrays.equals methods on
+  /// primitive arrays to the runtime kernels.
+  llvm::Instruction* lowerArraysOps(const UTF8* name, Signdef* signature,
+                                    std::vector<llvm::Value*>& args);
+
+  /// getStringIntrinsic - Get the runtime kernel implementing the String
+  /// method, or null if there is none.
+  llvm::Function* getStringIntrinsic(JavaMethod* meth, Signdef* signature);
  
   /// lowerArraycopy - Create a fast path for System.arraycopy.
   void lowerArraycopy(std::vector<llvm::Value*>& args);
@@ -550,6 +689,46 @@ private:
 //===--------------------- Yield point support  ---------------------------===//
 
   void checkYieldPoint();
+
+//===------------------- On-stack replacement support  --------------------===//
+
+  /// OSRInterval - Number of times the loop headers of a frame are reached
+  /// between two requests for an on-stack replacement of the frame. A power
+  /// of two.
+  static const uint32 OSRInterval = 1 << 14;
+
+  /// NumOSRKinds - Number of LLVM locals of a Java local: int, double,
+  /// long, float and object.
+  static const uint32 NumOSRKinds = 5;
+
+  /// osrBuffer - The buffer where the locals are copied before entering the
+  /// replacing version of the method.
+  llvm::Value* osrBuffer;
+
+  /// osrCount - The number of loop headers the frame reached, for on-stack
+  /// replacement.
+  llvm::Value* osrCount;
+
+  /// canReplaceOnStack - Can the current loop header transfer the frame to
+  /// a version of the method entered at the header?
+  bool canReplaceOnStack();
+
+  /// checkOnStackReplacement - Count the iterations of the loops of the
+  /// frame, and when they are hot, continue the execution of the method
+  /// in a freshly compiled version entered at the header.
+  void checkOnStackReplacement(uint32 index);
+
+  /// loadOSRLocals - Initialize the locals of the version entered by
+  /// on-stack replacement from the buffer of the replaced frame.
+  void loadOSRLocals(llvm::Value* buffer);
+
+  /// getOSRSlot - Get the address of the given kind of the local in the
+  /// buffer.
+  llvm::Value* getOSRSlot(llvm::Value* buffer, uint32 local, uint32 kind,
+                          llvm::Type* type);
+
+  /// getLocalsOfKind - Get the LLVM locals of the given kind.
+  std::vector<llvm::AllocaInst*>& getLocalsOfKind(uint32 kind);
 };
 
 enum Opcode {
@@ -33,6 +33,7 @@
 #include "JavaThread.h"
 #include "JavaTypes.h"
 #include "Jnjvm.h"
+#include "StartupProfile.h"
 
 #include "j3/JavaJITCompiler.h"
 #include "j3/J3Intrinsics.h"
@@ -287,34 +288,75 @@ void JavaJITCompiler::makeIMT(Class* cl) {
           IMT->contents[i] = (word_t)ThrowUnfoundInterface;
         }
       } else {
+        IMT->contents[i] = (word_t)makeIMTConflictTable(cl, atIndex) | 1;
+      }
+    }
+  }
+}
 
-        // Add one to have a NULL-terminated table.
-        uint32_t length = (2 * size + 1) * sizeof(word_t);
-      
-        word_t* table = (word_t*)
-          cl->classLoader->allocator.Allocate(length, "IMT");
-      
-        IMT->contents[i] = (word_t)table | 1;
-
-        uint32_t j = 0;
-        std::set<JavaMethod*>::iterator Interf = atIndex.begin();
-        for (std::vector<JavaMethod*>::iterator it = methods.begin(),
-             et = methods.end(); it != et; ++it, j += 2, ++Interf) {
-          JavaMethod* Imeth = *Interf;
-          JavaMethod* Cmeth = *it;
-          assert(Imeth != NULL);
-          assert(j < 2 * size - 1);
-          table[j] = (word_t)Imeth;
-          if (Cmeth) {
-            table[j + 1] = getPointerOrStub(*Cmeth, JavaMethod::Interface);
-          } else {
-            table[j + 1] = (word_t)ThrowUnfoundInterface;
-          }
-        }
-        assert(Interf == atIndex.end());
+word_t* JavaJITCompiler::makeIMTConflictTable(Class* cl,
+                                              std::set<JavaMethod*>& atIndex) {
+  // Group the interface methods by selector.
+  std::map<uint32_t, std::vector<JavaMethod*> > bySelector;
+  for (std::set<JavaMethod*>::iterator it = atIndex.begin(),
+       et = atIndex.end(); it != et; ++it) {
+    JavaMethod* Imeth = *it;
+    uint32_t selector =
+      InterfaceMethodTable::getSelector(Imeth->name, Imeth->type);
+    bySelector[selector].push_back(Imeth);
+  }
+
+  std::vector<uint32_t> selectors;
+  for (std::map<uint32_t, std::vector<JavaMethod*> >::iterator
+       it = bySelector.begin(), et = bySelector.end(); it != et; ++it) {
+    selectors.push_back(it->first);
+  }
+  uint32_t multiplier = 0;
+  uint32_t shift = InterfaceMethodTable::findPerfectHash(selectors, multiplier);
+  uint32_t length = InterfaceMethodTable::ConflictHeader + (1 << (32 - shift));
+
+  word_t* table = (word_t*)
+    cl->classLoader->allocator.Allocate(length * sizeof(word_t), "IMT");
+  table[0] = multiplier;
+  table[1] = shift;
+  for (uint32_t i = InterfaceMethodTable::ConflictHeader; i < length; ++i) {
+    table[i] = (word_t)ThrowUnfoundInterface;
+  }
+
+  for (std::map<uint32_t, std::vector<JavaMethod*> >::iterator
+       it = bySelector.begin(), et = bySelector.end(); it != et; ++it) {
+    std::vector<JavaMethod*>& methods = it->second;
+    uint32_t index = InterfaceMethodTable::getConflictIndex(it->first,
+                                                            multiplier, shift);
+    std::vector<JavaMethod*> targets;
+    bool SameMethod = true;
+    for (uint32_t j = 0; j < methods.size(); ++j) {
+      JavaMethod* Cmeth = cl->lookupMethodDontThrow(methods[j]->name,
+                                                    methods[j]->type,
+                                                    false, true, 0);
+      if (j != 0 && Cmeth != targets[0]) SameMethod = false;
+      targets.push_back(Cmeth);
+    }
+
+    if (SameMethod) {
+      table[index] = targets[0] ?
+        getPointerOrStub(*targets[0], JavaMethod::Interface) :
+        (word_t)ThrowUnfoundInterface;
+    } else {
+      // Different methods with the same selector: add one to have a
+      // NULL-terminated list.
+      uint32_t size = (2 * methods.size() + 1) * sizeof(word_t);
+      word_t* list = (word_t*)cl->classLoader->allocator.Allocate(size, "IMT");
+      for (uint32_t j = 0; j < methods.size(); ++j) {
+        list[2 * j] = (word_t)methods[j];
+        list[2 * j + 1] = targets[j] ?
+          getPointerOrStub(*targets[j], JavaMethod::Interface) :
+          (word_t)ThrowUnfoundInterface;
       }
+      table[index] = (word_t)list | 1;
     }
   }
+  return table;
 }
 
 void JavaJITCompiler::setMethod(Function* func, void* ptr, const char* name) {
@@ -342,6 +384,33 @@ void* JavaJITCompiler::materializeFunction(JavaMethod* meth, Class* customizeFor
   if (customizeFor == NULL || !getMethodInfo(meth)->isCustomizable) {
     meth->code = res;
   }
+  StartupProfile* recorder = StartupProfile::recorder;
+  if (recorder) {
+    recorder->recordMethod(meth);
+  }
+  return res;
+}
+
+void* JavaJITCompiler::compileOSR(JavaMethod* meth, uint32_t index) {
+  vmkit::VmkitModule::protectIR();
+  LLVMMethodInfo* LMI = getMethodInfo(meth);
+  void* res = NULL;
+  std::map<uint16, void*>::iterator I = LMI->osrEntries.find(index);
+  if (I != LMI->osrEntries.end()) {
+    res = I->second;
+  } else {
+    Function* func = parseOSRFunction(meth, index);
+    res = executionEngine->getPointerToGlobal(func);
+    llvm::GCFunctionInfo& GFI = GCInfo->getFunctionInfo(*func);
+
+    // The frames of the new version belong to the method, for stack walks
+    // and exception tables.
+    Jnjvm* vm = JavaThread::get()->getJVM();
+    vmkit::VmkitModule::addToVM(vm, &GFI, (JIT*)executionEngine, allocator, meth);
+    func->deleteBody();
+    LMI->osrEntries[index] = res;
+  }
+  vmkit::VmkitModule::unprotectIR();
   return res;
 }
 
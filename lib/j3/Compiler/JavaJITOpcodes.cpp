@@ -67,6 +67,14 @@ uint8 arrayType(JavaMethod* meth, unsigned int t) {
   }
 }
 
+// Is the class the only type whose instances can be assigned to it? A type
+// check against it is then a comparison of virtual tables.
+static bool hasNoSubtypes(CommonClass* cl) {
+  if (cl->isPrimitive()) return true;
+  if (cl->isArray()) return hasNoSubtypes(cl->asArrayClass()->baseClass());
+  return !cl->isInterface() && isFinal(cl->access);
+}
+
 static inline uint32 WREAD_U1(Reader& reader, bool init, uint32 &i, bool& wide) {
   if (wide) {
     wide = init;
@@ -147,6 +155,7 @@ void JavaJIT::compileOpcodes(Reader& reader, uint32 codeLength) {
 
       if (opinfo->backEdge) {
         checkYieldPoint();
+        if (canReplaceOnStack()) checkOnStackReplacement(i);
       }
     }
 
@@ -2253,9 +2262,11 @@ void JavaJIT::compileOpcodes(Reader& reader, uint32 codeLength) {
          
         Value* res = 0;
         if (cl) {
-          if (cl->isSecondaryClass()) {
-            res = CallInst::Create(intrinsics->IsSecondaryClassFunction,
-                                   classArgs, "", currentBlock);
+          if (hasNoSubtypes(cl)) {
+            res = new ICmpInst(*currentBlock, ICmpInst::ICMP_EQ, objVT, TheVT,
+                               "");
+          } else if (cl->isSecondaryClass()) {
+            res = isSecondaryType(objVT, TheVT);
           } else {
             Value* inDisplay = CallInst::Create(intrinsics->GetDisplayFunction,
                                                 objVT, "", currentBlock);
@@ -2304,7 +2315,7 @@ void JavaJIT::compileOpcodes(Reader& reader, uint32 codeLength) {
         bool thisReference = isThisReference(currentStackIndex - 1);
         Value* obj = pop();
         if (!thisReference) JITVerifyNull(obj);
-        monitorExit(obj);
+        monitorExit(obj, true);
         break;
       }
 
@@ -2784,9 +2795,26 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
   bool wide = false;
   uint32 start = reader.cursor;
   std::vector<uint8_t> stack;
+
+  // Exception handlers begin with the exception on the stack.
+  std::vector<bool> handlers(codeLength, false);
+  reader.cursor = start + codeLength;
+  uint16 nbe = reader.readU2();
+  for (uint16 i = 0; i < nbe; ++i) {
+    /* uint16 startpc = */ reader.readU2();
+    /* uint16 endpc = */ reader.readU2();
+    handlers[reader.readU2()] = true;
+    /* uint16 catche = */ reader.readU2();
+  }
+
   for(uint32 i = 0; i < codeLength; ++i) {
     reader.cursor = start + i;
     uint8 bytecode = reader.readU1();
+
+    if (handlers[i]) {
+      stack.clear();
+      stack.push_back(ATHROW);
+    }
     
     switch (bytecode) { 
       case NOP :
@@ -2894,7 +2922,7 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         stack.pop_back();
         stack.pop_back();
         stack.push_back(bytecode);
-        return false;
+        break;
 
       case LALOAD :
       case DALOAD :
@@ -2902,7 +2930,7 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         stack.pop_back();
         stack.push_back(bytecode);
         stack.push_back(bytecode);
-        return false;
+        break;
 
       case ISTORE :
       case FSTORE :
@@ -2958,7 +2986,7 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         stack.pop_back();
         stack.pop_back();
         stack.pop_back();
-        return false;
+        break;
 
       case LASTORE :
       case DASTORE :
@@ -2966,7 +2994,7 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         stack.pop_back();
         stack.pop_back();
         stack.pop_back();
-        return false;
+        break;
 
       case POP :
         stack.pop_back();
@@ -3087,9 +3115,20 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
 
       case IREM :
       case IDIV :
+        stack.pop_back();
+        stack.pop_back();
+        stack.push_back(bytecode);
+        break;
+
       case LREM :
       case LDIV :
-        return false;
+        stack.pop_back();
+        stack.pop_back();
+        stack.pop_back();
+        stack.pop_back();
+        stack.push_back(bytecode);
+        stack.push_back(bytecode);
+        break;
 
       case INEG :
       case FNEG :
@@ -3282,8 +3321,10 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         uint16 index = reader.readU2();
         Typedef* sign = ctpInfo->infoOfField(index);
         JavaField* field = ctpInfo->lookupField(index, true);
-        if (field == NULL) return false;
-        if (needsInitialisationCheck(field->classDef)) return false;
+        if (field == NULL || needsInitialisationCheck(field->classDef)) {
+          sawUnresolved = true;
+          return false;
+        }
         if (bytecode == GETSTATIC) {
           stack.push_back(bytecode);
           if (sign->isDouble() || sign->isLong()) {
@@ -3300,7 +3341,6 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
       }
 
       case PUTFIELD : {
-        if (isStatic(compilingMethod->access)) return false;
         i += 2;
         stack.pop_back(); // value
         uint16 index = reader.readU2();
@@ -3308,18 +3348,24 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         if (sign->isDouble() || sign->isLong()) {
           stack.pop_back(); // value
         }
-        if (stack.back() != ALOAD_0) return false;
+        // The field must be resolved: a null object throws to the call site.
+        if (ctpInfo->lookupField(index, false) == NULL) {
+          sawUnresolved = true;
+          return false;
+        }
         stack.pop_back(); // object
         break;
       }
 
       case GETFIELD : {
-        if (isStatic(compilingMethod->access)) return false;
-        if (stack.back() != ALOAD_0) return false;
         i += 2;
         stack.pop_back(); // object
         uint16 index = reader.readU2();
         Typedef* sign = ctpInfo->infoOfField(index);
+        if (ctpInfo->lookupField(index, false) == NULL) {
+          sawUnresolved = true;
+          return false;
+        }
         stack.push_back(bytecode);
         if (sign->isDouble() || sign->isLong()) {
           stack.push_back(bytecode);
@@ -3334,7 +3380,10 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         JavaMethod* meth = NULL;
         ctpInfo->infoOfMethod(index, ACC_VIRTUAL, cl, meth);
         i += 2;
-        if (meth == NULL) return false;
+        if (meth == NULL) {
+          sawUnresolved = true;
+          return false;
+        }
         if (getReceiver(stack, meth->getSignature()) != ALOAD_0) return false;
         bool customized = false;
         if (!(isFinal(cl->access) || isFinal(meth->access))) {
@@ -3348,6 +3397,8 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
           customized = true;
         }
         if (!canBeInlined(meth, customized)) return false;
+        if (meth->inlineCodeSize > MaxInlineSize) return false;
+        inlinedSize += meth->inlineCodeSize;
         updateStack(stack, meth->getSignature(), bytecode);
         break;
       }
@@ -3359,9 +3410,14 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         JavaMethod* meth = NULL;
         ctpInfo->infoOfMethod(index, ACC_VIRTUAL, cl, meth);
         i += 2;
-        if (meth == NULL) return false;
+        if (meth == NULL) {
+          sawUnresolved = true;
+          return false;
+        }
         if (getReceiver(stack, meth->getSignature()) != ALOAD_0) return false;
         if (!canBeInlined(meth, false)) return false;
+        if (meth->inlineCodeSize > MaxInlineSize) return false;
+        inlinedSize += meth->inlineCodeSize;
         updateStack(stack, meth->getSignature(), bytecode);
         break;
       }
@@ -3372,9 +3428,17 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         JavaMethod* meth = NULL;
         ctpInfo->infoOfMethod(index, ACC_STATIC, cl, meth);
         i += 2;
-        if (meth == NULL) return false;
+        if (meth == NULL) {
+          sawUnresolved = true;
+          return false;
+        }
         if (!canBeInlined(meth, false)) return false;
-        if (needsInitialisationCheck(cl->asClass())) return false;
+        if (meth->inlineCodeSize > MaxInlineSize) return false;
+        if (needsInitialisationCheck(cl->asClass())) {
+          sawUnresolved = true;
+          return false;
+        }
+        inlinedSize += meth->inlineCodeSize;
         updateStack(stack, meth->getSignature(), bytecode);
         break;
       }
@@ -3383,33 +3447,47 @@ bool JavaJIT::analyzeForInlining(Reader& reader, uint32 codeLength) {
         i += 4;
         return false;
 
-      case NEW :
+      case NEW : {
         i += 2;
-        return false;
+        CommonClass* cl = ctpInfo->isClassLoaded(reader.readU2());
+        if (cl == NULL || !cl->isClass() ||
+            needsInitialisationCheck(cl->asClass())) {
+          sawUnresolved = true;
+          return false;
+        }
+        stack.push_back(bytecode);
+        break;
+      }
 
       case NEWARRAY :
         ++i;
-        return false;
+        stack.pop_back();
+        stack.push_back(bytecode);
+        break;
       
       case ANEWARRAY :
+      case CHECKCAST :
+      case INSTANCEOF : {
         i += 2;
-        return false;
+        if (ctpInfo->isClassLoaded(reader.readU2()) == NULL) {
+          sawUnresolved = true;
+          return false;
+        }
+        stack.pop_back();
+        stack.push_back(bytecode);
+        break;
+      }
 
       case ARRAYLENGTH :
         stack.pop_back();
         stack.push_back(bytecode);
-        return false;
+        break;
 
       case ATHROW :
-        return false;
-
-      case CHECKCAST :
-        i += 2;
-        return false;
-
-      case INSTANCEOF :
-        i += 2;
-        return false;
+        // The next instruction is only reached by a branch, with an empty
+        // stack.
+        stack.clear();
+        break;
       
       case MONITORENTER :
       case MONITOREXIT :
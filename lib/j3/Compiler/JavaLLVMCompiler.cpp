@@ -12,6 +12,7 @@
 #include "llvm/PassManager.h"
 #include "llvm/Analysis/DIBuilder.h"
 #include "llvm/Analysis/LoopPass.h"
+#include "llvm/Transforms/Scalar.h"
 #include "llvm/Target/TargetData.h"
 
 #include "vmkit/JIT.h"
@@ -69,6 +70,9 @@ Function* JavaLLVMCompiler::parseFunction(JavaMethod* meth, Class* customizeFor)
     } else {
       jit.javaCompile();
       vmkit::VmkitModule::runPasses(func, JavaFunctionPasses);
+      if (JavaLoopPasses != NULL) {
+        vmkit::VmkitModule::runPasses(func, JavaLoopPasses);
+      }
       vmkit::VmkitModule::runPasses(func, J3FunctionPasses);
     }
     func->setLinkage(GlobalValue::ExternalLinkage);
@@ -87,6 +91,31 @@ Function* JavaLLVMCompiler::parseFunction(JavaMethod* meth, Class* customizeFor)
   return func;
 }
 
+Function* JavaLLVMCompiler::parseOSRFunction(JavaMethod* meth, uint16 index) {
+  LLVMMethodInfo* LMI = getMethodInfo(meth);
+  FunctionType* type =
+    FunctionType::get(LMI->getFunctionType()->getReturnType(),
+                      JavaIntrinsics.ptrType, false);
+  Function* func = Function::Create(type, GlobalValue::ExternalLinkage, "",
+                                    getLLVMModule());
+  func->setGC("vmkit");
+  if (useCooperativeGC()) {
+    func->addFnAttr(Attribute::NoInline);
+  }
+  func->addFnAttr(Attribute::NoUnwind);
+  functions.insert(std::make_pair(func, meth));
+
+  JavaJIT jit(this, meth, func, NULL);
+  jit.osrIndex = index;
+  jit.javaCompile();
+  vmkit::VmkitModule::runPasses(func, JavaFunctionPasses);
+  if (JavaLoopPasses != NULL) {
+    vmkit::VmkitModule::runPasses(func, JavaLoopPasses);
+  }
+  vmkit::VmkitModule::runPasses(func, J3FunctionPasses);
+  return func;
+}
+
 JavaMethod* JavaLLVMCompiler::getJavaMethod(const llvm::Function& F) {
   function_iterator E = functions.end();
   function_iterator I = functions.find(&F);
@@ -99,12 +128,15 @@ JavaLLVMCompiler::~JavaLLVMCompiler() {
   delete TheModule;
   delete DebugFactory;
   delete JavaFunctionPasses;
+  delete JavaLoopPasses;
   delete J3FunctionPasses;
   delete JavaNativeFunctionPasses;
   delete Context;
 }
 
 llvm::FunctionPass* createLowerConstantCallsPass(JavaLLVMCompiler* I);
+llvm::FunctionPass* createEliminateRangeChecksPass(JavaLLVMCompiler* I);
+llvm::FunctionPass* createElideLocksPass(JavaLLVMCompiler* I);
 
 void JavaLLVMCompiler::addJavaPasses() {
   JavaNativeFunctionPasses = new FunctionPassManager(TheModule);
@@ -112,9 +144,28 @@ void JavaLLVMCompiler::addJavaPasses() {
 
   J3FunctionPasses = new FunctionPassManager(TheModule);
   J3FunctionPasses->add(createLowerConstantCallsPass(this));
+
+  // Guard range checks in loops and let the unswitcher create the unchecked
+  // loops, before array lengths are lowered to loads. The induction variables
+  // must be in registers and the array lengths hoisted out of the loops,
+  // whatever passes the command line asked for. Natives have no such loops.
+  JavaLoopPasses = NULL;
+  if (vmkit::VmkitModule::isOptimizing()) {
+    JavaLoopPasses = new FunctionPassManager(TheModule);
+    JavaLoopPasses->add(new TargetData(TheModule));
+    JavaLoopPasses->add(createPromoteMemoryToRegisterPass());
+    JavaLoopPasses->add(createLICMPass());
+    JavaLoopPasses->add(createEliminateRangeChecksPass(this));
+    JavaLoopPasses->add(createLoopUnswitchPass());
+    JavaLoopPasses->add(createCFGSimplificationPass());
+    JavaLoopPasses->doInitialization();
+  }
   
   JavaFunctionPasses = new FunctionPassManager(TheModule);
   JavaFunctionPasses->add(new TargetData(TheModule));
+  // Remove the locks on thread-local objects before the allocations are
+  // inlined.
+  JavaFunctionPasses->add(createElideLocksPass(this));
   vmkit::VmkitModule::addCommandLinePasses(JavaFunctionPasses);
 }
 
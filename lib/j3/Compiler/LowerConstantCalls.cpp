@@ -172,6 +172,17 @@ bool LowerConstantCalls::runOnFunction(Function& F) {
           Value* VT = new LoadInst(VTPtr, "", CI);
           CI->replaceAllUsesWith(VT);
           CI->eraseFromParent();
+        } else if (V == intrinsics->NullCheckFunction) {
+          Changed = true;
+          // The load must stay, and keep the location of the check: the
+          // signal handler finds the frame of the fault with it.
+          Value* val = Call.getArgument(0); // get the object
+          Value* indexes[2] = { intrinsics->constantZero, intrinsics->constantZero };
+          Value* VTPtr = GetElementPtrInst::Create(val, indexes, "", CI);
+          Instruction* VT = new LoadInst(VTPtr, "", true, CI);
+          VT->setDebugLoc(CI->getDebugLoc());
+          CI->replaceAllUsesWith(VT);
+          CI->eraseFromParent();
         } else if (V == intrinsics->GetIMTFunction) {
           Changed = true;
           Value* val = Call.getArgument(0); // get the VT
@@ -56,7 +56,7 @@
                     i16 }
 
 %JavaMethod = type { i8*, i16, %Attribut*, i16, %JavaClass*,
-                     %UTF8*, %UTF8*, i8, i8*, i32 }
+                     %UTF8*, %UTF8*, i8, i8*, i32, i8*, i32, i8 }
 
 %JavaClassPrimitive = type { %JavaCommonClass, i32 }
 %JavaClassArray = type { %JavaCommonClass, %JavaCommonClass* }
@@ -106,6 +106,10 @@ declare i32 @arrayLength(%JavaObject*) readnone
 ;;; getVT - Get the VT of the object.
 declare %VT* @getVT(%JavaObject*) readnone 
 
+;;; nullCheck - Fault if the object is null. It reads the VT of the object,
+;;; which is also returned. It is not nounwind so that it is never deleted.
+declare %VT* @nullCheck(%JavaObject*) readonly
+
 ;;; getIMT - Get the IMT of the VT.
 declare %VT* @getIMT(%VT*) readnone 
 
@@ -208,6 +212,26 @@ declare void @j3JavaObjectAquire(%JavaObject*)
 ;;; block or method.
 declare void @j3JavaObjectRelease(%JavaObject*)
 
+;;; j3ArrayFill - Implements Arrays.fill on a primitive array. The value is
+;;; given by its bits, and the size of the elements by its log.
+declare void @j3ArrayFill(%JavaObject*, i64, i32)
+
+;;; j3ArrayEquals - Implements Arrays.equals on integral arrays.
+declare i8 @j3ArrayEquals(%JavaObject*, %JavaObject*, i32) readonly
+
+;;; j3StringEquals - Implements String.equals.
+declare i8 @j3StringEquals(%JavaObject*, %JavaObject*) readonly
+
+;;; j3StringHashCode - Implements String.hashCode. It caches the hash code
+;;; in the string.
+declare i32 @j3StringHashCode(%JavaObject*)
+
+;;; j3StringIndexOf - Implements String.indexOf(int).
+declare i32 @j3StringIndexOf(%JavaObject*, i32) readonly
+
+;;; j3NanoTime - Implements System.nanoTime, without a native transition.
+declare i64 @j3NanoTime()
+
 ;;; isSubclassOf - Returns if a type is a subtype of another type.
 declare i1 @isSubclassOf(%VT*, %VT*) readnone
 
@@ -215,6 +239,11 @@ declare i1 @isSubclassOf(%VT*, %VT*) readnone
 ;;; another type.
 declare i1 @isSecondaryClass(%VT*, %VT*) readnone
 
+;;; j3IsSecondaryType - The out-of-line path of a type check against a
+;;; secondary type, taken when the cache of the virtual table misses. The
+;;; last argument is the miss counter of the check, or null.
+declare i8 @j3IsSecondaryType(%VT*, %VT*, i8*)
+
 ;;; getClassDelegatee - Returns the java/lang/Class representation of the
 ;;; class. This method is lowered to the GEP to the class delegatee in
 ;;; the common class.
@@ -240,6 +269,14 @@ declare i8* @j3ResolveSpecialStub()
 declare i8* @j3ResolveStaticStub()
 declare i8* @j3ResolveInterface(%JavaObject*, %JavaMethod*, i32)
 
+;;; j3InlineCacheMiss - Resolve and cache the target of a virtual or
+;;; interface call whose receiver is not in the inline cache.
+declare i8* @j3InlineCacheMiss(i8*, %JavaObject*, %JavaMethod*, i32)
+
+;;; j3CompileOSR - Get the code of the version of a method entered at the
+;;; loop header of the given bytecode index, or null.
+declare i8* @j3CompileOSR(%JavaMethod*, i32)
+
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;; Exception methods ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
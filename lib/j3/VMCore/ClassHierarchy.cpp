@@ -0,0 +1,96 @@
+//===------ ClassHierarchy.cpp - Runtime class hierarchy analysis ---------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ClassHierarchy.h"
+#include "JavaAccess.h"
+#include "JavaClass.h"
+
+using namespace j3;
+
+vmkit::LockNormal ClassHierarchy::lock;
+std::map<JavaMethod*, ClassHierarchy::Implementations> ClassHierarchy::methods;
+
+void ClassHierarchy::addImplementation(JavaMethod* meth, JavaMethod* impl) {
+  Implementations& impls = methods[meth];
+  if (impls.unique == NULL) {
+    impls.unique = impl;
+    impls.guard = 1;
+  } else if (impls.unique != impl && impls.guard != 0) {
+    impls.guard = 0;
+  }
+}
+
+void ClassHierarchy::collectInterfaces(Class* cl,
+                                       std::set<Class*>& interfaces) {
+  for (uint32 i = 0; i < cl->nbInterfaces; ++i) {
+    if (interfaces.insert(cl->interfaces[i]).second) {
+      collectInterfaces(cl->interfaces[i], interfaces);
+    }
+  }
+  if (cl->super != NULL) collectInterfaces(cl->super, interfaces);
+}
+
+void ClassHierarchy::addClass(Class* cl) {
+  if (cl->isInterface()) return;
+
+  lock.lock();
+  // The methods of the class implement themselves and the methods they
+  // override in the super classes.
+  for (uint32 i = 0; i < cl->nbVirtualMethods; ++i) {
+    JavaMethod& meth = cl->virtualMethods[i];
+    // An abstract method is implemented by the sub classes, which record
+    // themselves when they are constructed.
+    if (isPrivate(meth.access) || isAbstract(meth.access)) continue;
+    addImplementation(&meth, &meth);
+
+    Class* super = cl->super;
+    while (super != NULL) {
+      JavaMethod* overridden = super->lookupMethodDontThrow(
+          meth.name, meth.type, false, true, NULL);
+      if (overridden == NULL || overridden->classDef->isInterface()) break;
+      if (!isPrivate(overridden->access)) {
+        addImplementation(overridden, &meth);
+      }
+      super = overridden->classDef->super;
+    }
+  }
+
+  // Concrete classes implement the methods of their interfaces, possibly
+  // with an inherited method.
+  if (!isAbstract(cl->access)) {
+    std::set<Class*> interfaces;
+    collectInterfaces(cl, interfaces);
+    for (std::set<Class*>::iterator it = interfaces.begin(),
+         et = interfaces.end(); it != et; ++it) {
+      Class* I = *it;
+      for (uint32 i = 0; i < I->nbVirtualMethods; ++i) {
+        JavaMethod& Imeth = I->virtualMethods[i];
+        JavaMethod* impl = cl->lookupMethodDontThrow(
+            Imeth.name, Imeth.type, false, true, NULL);
+        if (impl != NULL && !isAbstract(impl->access)) {
+          addImplementation(&Imeth, impl);
+        }
+      }
+    }
+  }
+  lock.unlock();
+}
+
+JavaMethod* ClassHierarchy::getUniqueImplementation(JavaMethod* meth,
+                                                    word_t*& guard) {
+  JavaMethod* result = NULL;
+  lock.lock();
+  std::map<JavaMethod*, Implementations>::iterator it = methods.find(meth);
+  if (it != methods.end() && it->second.guard != 0) {
+    result = it->second.unique;
+    guard = &(it->second.guard);
+  }
+  lock.unlock();
+  return result;
+}
@@ -0,0 +1,87 @@
+//===------- ClassHierarchy.h - Runtime class hierarchy analysis ----------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef J3_CLASS_HIERARCHY_H
+#define J3_CLASS_HIERARCHY_H
+
+#include <map>
+#include <set>
+
+#include "vmkit/Locks.h"
+#include "vmkit/System.h"
+
+namespace j3 {
+
+class Class;
+class JavaMethod;
+
+/// ClassHierarchy - Tracks, for every virtual and interface method, the
+/// implementations loaded so far. The JIT calls a method directly when it
+/// has a single implementation. Such a call is guarded by a word that the
+/// hierarchy clears when a class bringing a second implementation is
+/// constructed: the call site then goes back to the virtual dispatch. The
+/// guard holds the invalidation, so the call sites are not recorded.
+///
+class ClassHierarchy {
+public:
+
+  /// addClass - Record the implementations of a newly constructed class,
+  /// invalidating the methods that are now overridden. Must be called
+  /// before instances of the class can be created.
+  ///
+  static void addClass(Class* cl);
+
+  /// getUniqueImplementation - Get the only loaded implementation of the
+  /// given method, or null if there are none or more than one. Also
+  /// returns the guard of the answer.
+  ///
+  static JavaMethod* getUniqueImplementation(JavaMethod* meth,
+                                             word_t*& guard);
+
+private:
+
+  /// Implementations - What is known about the implementations of a method.
+  ///
+  struct Implementations {
+    /// unique - The only implementation, null if none is loaded yet.
+    ///
+    JavaMethod* unique;
+
+    /// guard - 1 while unique is the only implementation. Once cleared, it
+    /// is never set again. Compiled code reads it, so its address must not
+    /// change.
+    ///
+    word_t guard;
+
+    Implementations() : unique(NULL), guard(0) {}
+  };
+
+  /// lock - Protects the map.
+  ///
+  static vmkit::LockNormal lock;
+
+  /// methods - The implementations of the methods seen so far. Nodes of a
+  /// std::map do not move, which keeps the guards at the same address.
+  ///
+  static std::map<JavaMethod*, Implementations> methods;
+
+  /// addImplementation - Record that impl implements meth. Called with the
+  /// lock held.
+  ///
+  static void addImplementation(JavaMethod* meth, JavaMethod* impl);
+
+  /// collectInterfaces - Add the interfaces implemented by the class and
+  /// its super classes, and their super interfaces.
+  ///
+  static void collectInterfaces(Class* cl, std::set<Class*>& interfaces);
+};
+
+} // end namespace j3
+
+#endif
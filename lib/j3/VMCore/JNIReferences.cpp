@@ -0,0 +1,114 @@
+//===--------- JNIReferences.cpp - Management of JNI references -----------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "JavaThread.h"
+#include "JNIReferences.h"
+
+using namespace j3;
+
+JavaObject** JNILocalReferences::addJNIReference(JavaThread* th,
+                                                 JavaObject* obj) {
+  llvm_gcroot(obj, 0);
+
+  if (length == MAXIMUM_REFERENCES) {
+    if (next == NULL) {
+      next = new JNILocalReferences();
+      next->prev = this;
+    }
+    th->localJNIRefs = next;
+    return next->addJNIReference(th, obj);
+  } else {
+    vmkit::Collector::objectReferenceNonHeapWriteBarrier(
+        (gc**)&(localReferences[length]), (gc*)obj);
+    return &localReferences[length++];
+  }
+}
+
+void JNILocalReferences::removeJNIReferences(JavaThread* th, uint32_t num) {
+  JNILocalReferences* cur = this;
+  while (num > cur->length) {
+    assert(cur->prev && "No prev and deleting too much local references");
+    num -= cur->length;
+    cur->length = 0;
+    cur = cur->prev;
+  }
+  cur->length -= num;
+  th->localJNIRefs = cur;
+}
+
+JavaObject** JNIGlobalReferences::addJNIReference(JavaThread* th,
+                                                  JavaObject* obj) {
+  llvm_gcroot(obj, 0);
+  if (th->globalRefsCache == NULL) refill(th);
+
+  JavaObject** slot = th->globalRefsCache;
+  th->globalRefsCache = getNextFree(slot);
+  --th->globalRefsCacheSize;
+  *slot = NULL;
+  vmkit::Collector::objectReferenceNonHeapWriteBarrier((gc**)slot, (gc*)obj);
+  return slot;
+}
+
+void JNIGlobalReferences::removeJNIReference(JavaThread* th,
+                                             JavaObject** obj) {
+  setNextFree(obj, th->globalRefsCache);
+  th->globalRefsCache = obj;
+  if (++th->globalRefsCacheSize > 2 * CacheSize) flush(th, CacheSize);
+}
+
+void JNIGlobalReferences::refill(JavaThread* th) {
+  lock.lock();
+  if (freeList == NULL) {
+    Slab* slab = new Slab();
+    for (uint32_t i = 0; i < SlabSize - 1; ++i) {
+      setNextFree(&slab->globalReferences[i], &slab->globalReferences[i + 1]);
+    }
+    setNextFree(&slab->globalReferences[SlabSize - 1], NULL);
+    slab->next = slabs;
+    slabs = slab;
+    freeList = slab->globalReferences;
+  }
+
+  JavaObject** last = freeList;
+  uint32_t nb = 1;
+  while (nb < CacheSize && getNextFree(last) != NULL) {
+    last = getNextFree(last);
+    ++nb;
+  }
+  th->globalRefsCache = freeList;
+  th->globalRefsCacheSize = nb;
+  freeList = getNextFree(last);
+  setNextFree(last, NULL);
+  lock.unlock();
+}
+
+void JNIGlobalReferences::flush(JavaThread* th, uint32_t keep) {
+  JavaObject** last = NULL;
+  JavaObject** rest = th->globalRefsCache;
+  for (uint32_t i = 0; i < keep && rest != NULL; ++i) {
+    last = rest;
+    rest = getNextFree(rest);
+  }
+  if (rest == NULL) return;
+
+  if (last != NULL) {
+    setNextFree(last, NULL);
+  } else {
+    th->globalRefsCache = NULL;
+  }
+  th->globalRefsCacheSize = keep;
+
+  JavaObject** tail = rest;
+  while (getNextFree(tail) != NULL) tail = getNextFree(tail);
+
+  lock.lock();
+  setNextFree(tail, freeList);
+  freeList = rest;
+  lock.unlock();
+}
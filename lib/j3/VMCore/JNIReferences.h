@@ -1,4 +1,4 @@
-//===--------- JNIReferences.cpp - Management of JNI references -----------===//
+//===--------- JNIReferences.h - Management of JNI references -------------===//
 //
 //                            The VMKit project
 //
@@ -11,6 +11,7 @@
 #define JNI_REFERENCES_H
 
 #include "vmkit/Allocator.h"
+#include "vmkit/Locks.h"
 
 namespace j3 {
 
@@ -19,71 +20,112 @@ class JavaThread;
 
 #define MAXIMUM_REFERENCES 100
 
+/// JNILocalReferences - A block of the local references of a thread. The
+/// blocks of a thread are chained, the thread pointing to the block in use.
+/// Blocks emptied when native methods return are kept after it for the next
+/// references.
+///
 class JNILocalReferences {
   friend class JavaThread;
 
 private:
   JNILocalReferences* prev;
+  JNILocalReferences* next;
   uint32_t length;
   JavaObject* localReferences[MAXIMUM_REFERENCES];
 
 public:
-  
+
   JNILocalReferences() {
     prev = 0;
+    next = 0;
     length = 0;
   }
 
+  ~JNILocalReferences() {
+    delete next;
+  }
+
   JavaObject** addJNIReference(JavaThread* th, JavaObject* obj);
 
   void removeJNIReferences(JavaThread* th, uint32_t num);
 
 };
 
+/// JNIGlobalReferences - The table of the global references of a VM. The
+/// references are allocated in slabs that are never freed. A free slot
+/// holds the next free slot with the low bit set, so that the GC skips it.
+/// Threads take free slots from the table by batches and keep the slots
+/// they delete, so that the lock of the table is only taken once in a
+/// while.
+///
 class JNIGlobalReferences {
   friend class Jnjvm;
 
 private:
-  JNIGlobalReferences* next;
-  JNIGlobalReferences* prev;
-  uint32_t length;
-  uint32_t count;
-  JavaObject* globalReferences[MAXIMUM_REFERENCES];
+  /// SlabSize - Number of references in a slab.
+  ///
+  static const uint32_t SlabSize = 256;
+
+  /// CacheSize - Number of free slots a thread takes from the table at a
+  /// time. A thread gives back its slots beyond twice this number.
+  ///
+  static const uint32_t CacheSize = 32;
+
+  struct Slab {
+    Slab* next;
+    JavaObject* globalReferences[SlabSize];
+  };
+
+  /// slabs - The slabs allocated so far.
+  ///
+  Slab* slabs;
+
+  /// freeList - The free slots not cached by a thread.
+  ///
+  JavaObject** freeList;
+
+  /// lock - Protects the slabs and the free list.
+  ///
+  vmkit::LockNormal lock;
+
+  static bool isFree(JavaObject* value) {
+    return ((word_t)value & 1) != 0;
+  }
+
+  static JavaObject** getNextFree(JavaObject** slot) {
+    return (JavaObject**)((word_t)*slot & ~1);
+  }
 
+  static void setNextFree(JavaObject** slot, JavaObject** next) {
+    *slot = (JavaObject*)((word_t)next | 1);
+  }
+
+  /// refill - Give free slots to the thread, allocating a slab if there
+  /// are none.
+  ///
+  void refill(JavaThread* th);
+
+  /// flush - Give back to the table the free slots of the thread beyond the
+  /// given number.
+  ///
+  void flush(JavaThread* th, uint32_t keep);
 
 public:
   JNIGlobalReferences() {
-    next = 0;
-    prev = 0;
-    length = 0;
-    count = 0;
+    slabs = 0;
+    freeList = 0;
   }
 
-  JavaObject** addJNIReference(JavaObject* obj) {
-    llvm_gcroot(obj, 0);
-    if (length == MAXIMUM_REFERENCES) {
-      if (!next) {
-        next = new JNIGlobalReferences();
-        next->prev = this;
-      }
-      return next->addJNIReference(obj);
-    } else {
-      ++count;
-      vmkit::Collector::objectReferenceNonHeapWriteBarrier(
-          (gc**)&(globalReferences[length]), (gc*)obj);
-      return &globalReferences[length++];
-    }
-  }
+  JavaObject** addJNIReference(JavaThread* th, JavaObject* obj);
+
+  void removeJNIReference(JavaThread* th, JavaObject** obj);
 
-  void removeJNIReference(JavaObject** obj) {
-    if (((word_t)obj >= (word_t)globalReferences) &&
-        ((word_t)obj) < (word_t)(globalReferences + MAXIMUM_REFERENCES)) {
-      *obj = NULL;
-      --count;
-    } else {
-      assert(next && "No global reference located there");
-      next->removeJNIReference(obj);
-    }
+  /// releaseCache - Give back the free slots of a thread that stops using
+  /// JNI.
+  ///
+  void releaseCache(JavaThread* th) {
+    flush(th, 0);
   }
 };
 
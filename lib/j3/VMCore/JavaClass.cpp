@@ -24,6 +24,7 @@
 #include "Jnjvm.h"
 #include "LockedMap.h"
 #include "Reader.h"
+#include "StartupProfile.h"
 
 #include <cstring>
 
@@ -124,6 +125,7 @@ Class::~Class() {
   }
 
   classLoader->allocator.Deallocate(IsolateInfo);
+  classLoader->allocator.Deallocate(memberIndex);
   
   // Currently, only regular classes have a heap allocated virtualVT.
   // Array classes have a C++ allocated virtualVT and primitive classes
@@ -237,6 +239,8 @@ Class::Class(JnjvmClassLoader* loader, const UTF8* n, ClassBytes* B) :
   staticFields = 0;
   ownerClass = 0;
   innerAccess = 0;
+  memberIndex = 0;
+  biasRevocations = 0;
   access = JNJVM_CLASS;
   memset(IsolateInfo, 0, sizeof(TaskClassMirror) * NR_ISOLATES);
 }
@@ -327,6 +331,51 @@ JavaMethod* Class::lookupSpecialMethodDontThrow(const UTF8* name,
   return meth;
 }
 
+JavaMethod* Class::lookupVirtualMethodAt(uint32 offset) {
+  for (Class* cl = this; cl != NULL; cl = cl->super) {
+    for (uint32 i = 0; i < cl->nbVirtualMethods; ++i) {
+      JavaMethod& meth = cl->virtualMethods[i];
+      if (meth.offset == offset && !isPrivate(meth.access)) {
+        return isAbstract(meth.access) ? NULL : &meth;
+      }
+    }
+  }
+  return NULL;
+}
+
+template <class T>
+void MemberTable<T>::initialise(T* members, uint32 nb,
+                                vmkit::BumpPtrAllocator& allocator) {
+  if (nb < MemberIndex::MinMembers) return;
+  uint32 size = 1;
+  while (size < 2 * nb) size <<= 1;
+  mask = size - 1;
+  slots = (T**)allocator.Allocate(size * sizeof(T*), "Member table");
+  for (uint32 i = 0; i < nb; ++i) {
+    T* cur = &(members[i]);
+    uint32 index = hash(cur->name, cur->type) & mask;
+    while (slots[index] != NULL) index = (index + 1) & mask;
+    slots[index] = cur;
+  }
+}
+
+MemberIndex::MemberIndex(Class* cl) {
+  vmkit::BumpPtrAllocator& allocator = cl->classLoader->allocator;
+  virtualMethods.initialise(cl->virtualMethods, cl->nbVirtualMethods,
+                            allocator);
+  staticMethods.initialise(cl->staticMethods, cl->nbStaticMethods, allocator);
+  virtualFields.initialise(cl->virtualFields, cl->nbVirtualFields, allocator);
+  staticFields.initialise(cl->staticFields, cl->nbStaticFields, allocator);
+}
+
+MemberIndex* Class::buildMemberIndex() {
+  MemberIndex* index =
+    new(classLoader->allocator, "Member index") MemberIndex(this);
+  // Another thread may have built the index concurrently: keep the first one.
+  MemberIndex* old = __sync_val_compare_and_swap(&memberIndex, NULL, index);
+  return old ? old : index;
+}
+
 JavaMethod* Class::lookupMethodDontThrow(const UTF8* name, const UTF8* type,
                                          bool isStatic, bool recurse,
                                          Class** methodCl) {
@@ -341,11 +390,25 @@ JavaMethod* Class::lookupMethodDontThrow(const UTF8* name, const UTF8* type,
     nb = nbVirtualMethods;
   }
   
-  for (uint32 i = 0; i < nb; ++i) {
-    JavaMethod& res = methods[i];
-    if (res.name->equals(name) && res.type->equals(type)) {
+  MemberIndex* index = getMemberIndex();
+  const MemberTable<JavaMethod>* table = NULL;
+  if (index != NULL) {
+    table = isStatic ? &(index->staticMethods) : &(index->virtualMethods);
+  }
+
+  if (table != NULL && table->slots != NULL) {
+    JavaMethod* res = table->lookup(name, type);
+    if (res != NULL) {
       if (methodCl) *methodCl = (Class*)this;
-      return &res;
+      return res;
+    }
+  } else {
+    for (uint32 i = 0; i < nb; ++i) {
+      JavaMethod& res = methods[i];
+      if (res.name->equals(name) && res.type->equals(type)) {
+        if (methodCl) *methodCl = (Class*)this;
+        return &res;
+      }
     }
   }
 
@@ -402,11 +465,25 @@ Class::lookupFieldDontThrow(const UTF8* name, const UTF8* type,
     nb = nbVirtualFields;
   }
   
-  for (uint32 i = 0; i < nb; ++i) {
-    JavaField& res = fields[i];
-    if (res.name->equals(name) && res.type->equals(type)) {
+  MemberIndex* index = getMemberIndex();
+  const MemberTable<JavaField>* table = NULL;
+  if (index != NULL) {
+    table = isStatic ? &(index->staticFields) : &(index->virtualFields);
+  }
+
+  if (table != NULL && table->slots != NULL) {
+    JavaField* res = table->lookup(name, type);
+    if (res != NULL) {
       if (definingClass) *definingClass = this;
-      return &res;
+      return res;
+    }
+  } else {
+    for (uint32 i = 0; i < nb; ++i) {
+      JavaField& res = fields[i];
+      if (res.name->equals(name) && res.type->equals(type)) {
+        if (definingClass) *definingClass = this;
+        return &res;
+      }
     }
   }
 
@@ -451,6 +528,7 @@ JavaObject* UserClass::doNew(Jnjvm* vm) {
          && "Uninitialized class when allocating.");
   assert(getVirtualVT() && "No VT\n");
   res = (JavaObject*)gc::operator new(getVirtualSize(), getVirtualVT());
+  if (!isBiasable()) res->header |= vmkit::ThinLock::UnbiasableMask;
 
   return res;
 }
@@ -639,6 +717,9 @@ void JavaMethod::initialise(Class* cl, const UTF8* N, const UTF8* T, uint16 A) {
   access = A;
   isCustomizable = false;
   offset = 0;
+  invokeCache = NULL;
+  inlineCodeSize = 0;
+  inlineState = InlineUnknown;
 }
 
 void JavaField::initialise(Class* cl, const UTF8* N, const UTF8* T, uint16 A) {
@@ -920,9 +1001,14 @@ void Class::resolveClass() {
   if (isResolved() || isErroneous()) return;
   resolveParents();
   loadExceptions();
+  if (memberIndex == NULL) buildMemberIndex();
   // Do a compare and swap in case another thread initialized the class.
   __sync_val_compare_and_swap(
       &(getCurrentTaskClassMirror().status), loaded, resolved);
+  StartupProfile* recorder = StartupProfile::recorder;
+  if (recorder) {
+    recorder->recordClass(StartupProfile::Resolve, this);
+  }
   assert(isResolved() || isErroneous());
 }
 
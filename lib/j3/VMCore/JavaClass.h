@@ -375,6 +375,68 @@ public:
                                             bool doClinit);
 };
 
+/// MemberTable - An open-addressed hash table of methods or fields, keyed on
+/// their name and type. Slots are filled at construction and never modified
+/// afterwards, so lookups do not need any lock.
+///
+template <class T>
+class MemberTable {
+public:
+
+  /// mask - The number of slots minus one. The number of slots is a power of
+  /// two, at least twice the number of members.
+  ///
+  uint32 mask;
+
+  /// slots - The members, stored at the hash of their name and type.
+  ///
+  T** slots;
+
+  /// hash - The hash of a member. Computed on the contents of the UTF8s so
+  /// that names interned by another class loader find the same slot.
+  ///
+  static uint32 hash(const UTF8* name, const UTF8* type) {
+    return name->hash() * 31 + type->hash();
+  }
+
+  /// initialise - Fill the table with the given members.
+  ///
+  void initialise(T* members, uint32 nb, vmkit::BumpPtrAllocator& allocator);
+
+  /// lookup - Find the member with the given name and type, or null. Names
+  /// interned in the same UTF8Map compare with a pointer equality.
+  ///
+  T* lookup(const UTF8* name, const UTF8* type) const {
+    for (uint32 i = hash(name, type) & mask; slots[i] != NULL;
+         i = (i + 1) & mask) {
+      T* cur = slots[i];
+      if (cur->name->equals(name) && cur->type->equals(type)) return cur;
+    }
+    return NULL;
+  }
+};
+
+/// MemberIndex - Hashed index of the members defined by a class. Tables are
+/// only allocated for member lists that are long enough to make a linear
+/// scan more expensive than hashing the name and type.
+///
+class MemberIndex : public vmkit::PermanentObject {
+public:
+
+  /// MinMembers - Below this number of members, a linear scan is used.
+  ///
+  static const uint32 MinMembers = 8;
+
+  MemberTable<JavaMethod> virtualMethods;
+  MemberTable<JavaMethod> staticMethods;
+  MemberTable<JavaField> virtualFields;
+  MemberTable<JavaField> staticFields;
+
+  /// MemberIndex - Build the index of the given class.
+  ///
+  MemberIndex(Class* cl);
+};
+
 /// ClassPrimitive - This class represents internal classes for primitive
 /// types, e.g. java/lang/Integer.TYPE.
 ///
@@ -503,6 +565,49 @@ public:
   ///
   uint32 staticSize;
 
+  /// memberIndex - Hashed index of the methods and fields of this class.
+  /// Built when the class is resolved, null before.
+  ///
+  MemberIndex* memberIndex;
+
+  /// biasRevocations - Number of biased locks of instances of this class
+  /// revoked by another thread than their owner, up to the threshold.
+  ///
+  uint32 biasRevocations;
+
+  /// BiasRevocationThreshold - Number of revocations past which the
+  /// instances of this class are allocated unbiasable.
+  ///
+  static const uint32 BiasRevocationThreshold = 20;
+
+  /// biasRevoked - Count the revocation of the bias of an instance.
+  ///
+  void biasRevoked() {
+    if (biasRevocations < BiasRevocationThreshold) {
+      __sync_fetch_and_add(&biasRevocations, 1);
+    }
+  }
+
+  /// isBiasable - Can the new instances of this class be biased?
+  ///
+  bool isBiasable() const {
+    return biasRevocations < BiasRevocationThreshold;
+  }
+
+  /// getMemberIndex - Get the member index of this class, building it if
+  /// the class is resolved but has no index yet (e.g. precompiled classes).
+  /// Returns null if the class is not resolved.
+  ///
+  MemberIndex* getMemberIndex() {
+    if (memberIndex != NULL) return memberIndex;
+    if (!isResolved()) return NULL;
+    return buildMemberIndex();
+  }
+
+  /// buildMemberIndex - Build and install the member index of this class.
+  ///
+  MemberIndex* buildMemberIndex();
+
   /// getVirtualSize - Get the virtual size of instances of this class.
   ///
   uint32 getVirtualSize() const { return virtualSize; }
@@ -555,6 +660,12 @@ public:
   JavaMethod* lookupSpecialMethodDontThrow(const UTF8* name,
                                            const UTF8* type,
                                            Class* current);
+
+  /// lookupVirtualMethodAt - Get the method that instances of this class
+  /// run for the given virtual table offset, looking in the super classes.
+  /// Returns null if the method is abstract.
+  ///
+  JavaMethod* lookupVirtualMethodAt(uint32 offset);
   
   /// lookupMethod - Lookup a method and throw an exception if not found.
   ///
@@ -909,6 +1020,38 @@ public:
   ///
   uint32 offset;
 
+  /// invokeCache - The receiver virtual tables of the virtual calls made
+  /// through the invoke functions, from JNI and reflection, with the method
+  /// they dispatch to. Allocated on the first call whose receiver is not
+  /// an instance of classDef.
+  ///
+  InlineCache* invokeCache;
+
+  /// getVirtualCode - Get the code that a virtual call of this method runs
+  /// on the given object, compiling it if needed.
+  ///
+  void* getVirtualCode(JavaObject* obj);
+
+  /// InlineState - What the compiler found when analyzing the method for
+  /// inlining.
+  ///
+  enum InlineState {
+    InlineUnknown,      /// The method has not been analyzed yet.
+    Inlinable,          /// The method can be inlined.
+    NotInlinable        /// The method can not be inlined.
+  };
+
+  /// inlineCodeSize - The length of the bytecode of the method and of the
+  /// callees inlined in it, for the inlining budget. Valid once inlineState
+  /// is not InlineUnknown.
+  ///
+  uint32 inlineCodeSize;
+
+  /// inlineState - The cached inlining summary of the method. A method is
+  /// only known to be inlinable when it is not customized.
+  ///
+  uint8 inlineState;
+
   /// lookupAttribut - Look up an attribut in the method's attributs. Returns
   /// null if the attribut is not found.
   ///
@@ -1091,6 +1234,8 @@ public:
   
   #define JNI_NAME_PRE "Java_"
   #define JNI_NAME_PRE_LEN 5
+  #define JNI_CRITICAL_NAME_PRE "JavaCritical_"
+  #define JNI_CRITICAL_NAME_PRE_LEN 13
   
 };
 
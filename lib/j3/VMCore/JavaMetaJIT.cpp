@@ -56,6 +56,48 @@ using namespace j3;
   }\
 }
   
+void* JavaMethod::getVirtualCode(JavaObject* obj) {
+  llvm_gcroot(obj, 0);
+  UserCommonClass* objCl = JavaObject::getClass(obj);
+  if (objCl == classDef || isFinal(access) || isPrivate(access)) {
+    return compiledPtr();
+  }
+
+  word_t VT = (word_t)obj->getVirtualTable();
+  InlineCache* cache = invokeCache;
+  if (cache != NULL) {
+    for (uint32 i = 0; i < InlineCache::NumEntries; ++i) {
+      if (cache->entries[2 * i] == VT) {
+        return ((JavaMethod*)cache->entries[2 * i + 1])->compiledPtr();
+      }
+    }
+  } else {
+    cache = new (classDef->classLoader->allocator, "Inline cache")
+      InlineCache();
+    InlineCache* old = __sync_val_compare_and_swap(&invokeCache, NULL, cache);
+    if (old != NULL) cache = old;
+  }
+  ++cache->misses;
+
+  // Virtual methods are found by their offset in the virtual table,
+  // interface methods by their name.
+  UserClass* lookup = objCl->isArray() ? objCl->super : objCl->asClass();
+  JavaMethod* meth = NULL;
+  if (!isInterface(classDef->access) && offset != 0) {
+    meth = lookup->lookupVirtualMethodAt(offset);
+  }
+  if (meth == NULL) {
+    meth = lookup->lookupMethodDontThrow(name, type, false, true, NULL);
+  }
+  assert(meth && "No method found");
+  assert(objCl->isSubclassOf(meth->classDef) && "Wrong type");
+
+  // Cache the method and not its code, which on-stack replacement and
+  // code replacement may change.
+  if (!isAbstract(meth->access)) cache->add(VT, (word_t)meth);
+  return meth->compiledPtr();
+}
+
 #define DO_TRY
 #define DO_CATCH if (th->pendingException) { th->throwFromJava(); }
 
@@ -164,16 +206,7 @@ TYPE JavaMethod::invoke##TYPE_NAME##VirtualBuf(Jnjvm* vm, UserClass* cl, JavaObj
   llvm_gcroot(obj, 0); \
   verifyNull(obj);\
   Signdef* sign = getSignature(); \
-  UserClass* objCl = JavaObject::getClass(obj)->isArray() ? JavaObject::getClass(obj)->super : JavaObject::getClass(obj)->asClass(); \
-  JavaMethod* meth = NULL; \
-  if (objCl == classDef || isFinal(access)) { \
-    meth = this; \
-  } else { \
-    meth = objCl->lookupMethodDontThrow(name, type, false, true, &cl); \
-  } \
-  assert(meth && "No method found"); \
-  assert(objCl->isSubclassOf(meth->classDef) && "Wrong type"); \
-  void* func = meth->compiledPtr(); \
+  void* func = getVirtualCode(obj); \
   FUNC_TYPE_VIRTUAL_BUF call = (FUNC_TYPE_VIRTUAL_BUF)sign->getVirtualCallBuf(); \
   JavaThread* th = JavaThread::get(); \
   th->startJava(); \
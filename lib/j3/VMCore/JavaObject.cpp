@@ -27,6 +27,53 @@ uint16_t JavaObject::hashCodeGenerator = hashCodeIncrement;
 static const uint64_t HashMask = ((1 << vmkit::HashBits) - 1) << vmkit::GCBits;
 
 
+uint32_t InterfaceMethodTable::findPerfectHash(
+    const std::vector<uint32_t>& selectors, uint32_t& multiplier) {
+  uint32_t bits = 1;
+  while ((1u << bits) < selectors.size()) ++bits;
+  uint32_t seed = 0x9e3779b9;
+  std::vector<bool> used;
+  while (true) {
+    // Try a few odd multipliers before growing the table.
+    for (uint32_t attempt = 0; attempt < 32; ++attempt) {
+      seed = seed * 1664525 + 1013904223;
+      uint32_t candidate = seed | 1;
+      used.assign(1 << bits, false);
+      bool collision = false;
+      for (uint32_t i = 0; i < selectors.size(); ++i) {
+        uint32_t index = (uint32_t)(selectors[i] * candidate) >> (32 - bits);
+        if (used[index]) {
+          collision = true;
+          break;
+        }
+        used[index] = true;
+      }
+      if (!collision) {
+        multiplier = candidate;
+        return 32 - bits;
+      }
+    }
+    ++bits;
+    assert(bits < 32 && "Can't find a perfect hash");
+  }
+}
+
+vmkit::SpinLock InlineCache::lock;
+
+void InlineCache::add(word_t VT, word_t code) {
+  lock.acquire();
+  for (uint32 i = 0; i < NumEntries; ++i) {
+    if (entries[2 * i] == VT) break;
+    if (entries[2 * i] == 0) {
+      entries[2 * i + 1] = code;
+      __sync_synchronize();
+      entries[2 * i] = VT;
+      break;
+    }
+  }
+  lock.release();
+}
+
 /// hashCode - Return the hash code of this object.
 uint32_t JavaObject::hashCode(JavaObject* self) {
   llvm_gcroot(self, 0);
@@ -56,6 +103,11 @@ uint32_t JavaObject::hashCode(JavaObject* self) {
   do {
     header = self->header;
     if ((header & HashMask) != 0) break;
+    // The owner of a bias updates the header without atomic operations.
+    if (vmkit::ThinLock::biasedToOtherThread(header)) {
+      vmkit::ThinLock::revokeBias(self);
+      continue;
+    }
     word_t newHeader = header | val;
     assert((newHeader & ~HashMask) == header);
     __sync_val_compare_and_swap(&(self->header), header, newHeader);
@@ -219,7 +271,15 @@ void JavaObject::acquire(JavaObject* self) {
 
 void JavaObject::release(JavaObject* self) {
   llvm_gcroot(self, 0);
-  vmkit::ThinLock::release(self, JavaThread::get()->getJVM()->lockSystem);
+  JavaThread* thread = JavaThread::get();
+  vmkit::LockSystem& table = thread->getJVM()->lockSystem;
+
+  // An unbalanced monitorexit must not corrupt the header.
+  if (!vmkit::ThinLock::owner(self, table)) {
+    thread->getJVM()->illegalMonitorStateException(self);
+    UNREACHABLE();
+  }
+  vmkit::ThinLock::release(self, table);
 }
 
 bool JavaObject::owner(JavaObject* self) {
@@ -10,6 +10,9 @@
 #ifndef JNJVM_JAVA_OBJECT_H
 #define JNJVM_JAVA_OBJECT_H
 
+#include <cassert>
+#include <vector>
+
 #include "vmkit/Allocator.h"
 #include "vmkit/UTF8.h"
 #include "vmkit/Locks.h"
@@ -24,19 +27,142 @@ union jvalue;
 
 namespace j3 {
 
+class JavaMethod;
 class JavaObject;
 class JavaThread;
 class Jnjvm;
 class Typedef;
 class UserCommonClass;
 
+/// InterfaceMethodTable - The table used for invokeinterface. An interface
+/// method is identified by its selector, a hash of its name and type that
+/// call sites know statically. The low bits of the selector give the slot
+/// in the table. A slot either holds the code to call, or, when selectors
+/// with different targets share it, a conflict table tagged with 1.
+///
+/// A conflict table is a perfect hash of the selectors of the slot: word 0
+/// is a multiplier, word 1 a shift, followed by one entry per hash value.
+/// Finding the target is therefore always a constant number of loads. In
+/// the unlikely case two different methods have the same selector, their
+/// entry is itself tagged with 1 and points to a null-terminated list of
+/// (interface method, code) pairs.
+///
 class InterfaceMethodTable : public vmkit::PermanentObject {
 public:
-	static const uint32_t NumIndexes = 29;
+	static const uint32_t NumIndexes = 32;
 	word_t contents[NumIndexes];
 
+  /// ConflictHeader - Number of header words in a conflict table.
+  ///
+  static const uint32_t ConflictHeader = 2;
+
+  /// getSelector - Get the selector of the given method. The UTF8 hash is
+  /// mixed so that all its bits contribute to the slot.
+  ///
+  static uint32_t getSelector(const vmkit::UTF8* name,
+                              const vmkit::UTF8* type) {
+    uint32_t h = name->hash() * 31 + type->hash();
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+  }
+
+  static uint32_t getIndex(uint32_t selector) {
+    return selector & (NumIndexes - 1);
+  }
+
   static uint32_t getIndex(const vmkit::UTF8* name, const vmkit::UTF8* type) {
-    return (name->hash() + type->hash()) % NumIndexes;
+    return getIndex(getSelector(name, type));
+  }
+
+  /// getConflictIndex - Get the entry of a selector in a conflict table.
+  ///
+  static uint32_t getConflictIndex(uint32_t selector, word_t multiplier,
+                                   word_t shift) {
+    return ConflictHeader + ((uint32_t)(selector * multiplier) >> shift);
+  }
+
+  /// findPerfectHash - Find a multiplier that maps the given distinct
+  /// selectors to distinct entries. Returns the shift to use, the table
+  /// having 1 << (32 - shift) entries.
+  ///
+  static uint32_t findPerfectHash(const std::vector<uint32_t>& selectors,
+                                  uint32_t& multiplier);
+
+  /// getEntry - Get the address of the code of the given interface method.
+  ///
+  word_t* getEntry(JavaMethod* meth, uint32_t selector) {
+    word_t* entry = &contents[getIndex(selector)];
+    if ((*entry & 1) == 0) return entry;
+    word_t* table = (word_t*)(*entry & ~1);
+    entry = &table[getConflictIndex(selector, table[0], table[1])];
+    if ((*entry & 1) == 0) return entry;
+    table = (word_t*)(*entry & ~1);
+    while (table[0] != (word_t)meth && table[0] != 0) table += 2;
+    assert(table[0] != 0 && "Method not in the IMT");
+    return &table[1];
+  }
+};
+
+/// InlineCache - The receiver virtual tables seen at a virtual or interface
+/// call site, with the code they dispatch to. Compiled code compares the
+/// receiver's VT against the entries and calls the cached code on a hit.
+/// Entries are filled once and never modified, so readers need no lock.
+///
+class InlineCache : public vmkit::PermanentObject {
+public:
+  /// NumEntries - Number of receiver types cached before the call site
+  /// is megamorphic.
+  ///
+  static const uint32_t NumEntries = 2;
+
+  /// entries - Pairs of (VT, code). The code is written before the VT.
+  ///
+  word_t entries[2 * NumEntries];
+
+  /// HotHits - Number of hits on the first entry after which the call site
+  /// is hot. The hits are not counted further.
+  ///
+  static const word_t HotHits = 1000;
+
+  /// hits - Calls dispatched through the first entry of the cache, up to
+  /// HotHits. Not updated atomically, this is only a profile.
+  ///
+  word_t hits;
+
+  /// misses - Calls that went to the runtime. Not updated atomically, this
+  /// is only a profile.
+  ///
+  word_t misses;
+
+  /// lock - Protects the filling of entries.
+  ///
+  static vmkit::SpinLock lock;
+
+  /// add - Cache the code of the given VT, if there is a free entry.
+  ///
+  void add(word_t VT, word_t code);
+
+  /// isMonomorphic - Has the call site only seen one receiver type?
+  ///
+  bool isMonomorphic() const {
+    return entries[0] != 0 && entries[2] == 0;
+  }
+
+  /// isMegamorphic - Are all the entries taken? Receiver types not cached
+  /// are then dispatched through the virtual table or the IMT.
+  ///
+  bool isMegamorphic() const {
+    return entries[2 * (NumEntries - 1)] != 0;
+  }
+
+  /// isHot - Has the first entry of the cache been hit often?
+  ///
+  bool isHot() const {
+    return hits >= HotHits;
   }
 };
 
@@ -282,7 +408,8 @@ public:
   /// acquire - Acquire the lock on this object.
   static void acquire(JavaObject* self);
 
-  /// release - Release the lock on this object
+  /// release - Release the lock on this object. Throws an
+  /// IllegalMonitorStateException if the thread does not hold it.
   static void release(JavaObject* self);
 
   /// owner - Returns true if the current thread is the owner of this object's
@@ -12,6 +12,7 @@
 #include "ClasspathReflect.h"
 #include "JavaArray.h"
 #include "JavaClass.h"
+#include "JavaCompiler.h"
 #include "JavaConstantPool.h"
 #include "JavaString.h"
 #include "JavaThread.h"
@@ -22,6 +23,7 @@
 #include "j3/OpcodeNames.def"
 
 #include <cstdarg>
+#include <cstring>
 
 using namespace j3;
 
@@ -294,24 +296,161 @@ extern "C" void j3JavaObjectAquire(JavaObject* obj) {
   JavaObject::acquire(obj);
 }
 
-// Never throws.
+// Throws if the thread does not hold the lock.
 extern "C" void j3JavaObjectRelease(JavaObject* obj) {
   llvm_gcroot(obj, 0);
   JavaObject::release(obj);
 }
 
+// The kernels below work on 64-bit words: a word holds 8 bytes, 4 chars or
+// 2 ints of an array.
+
+static const uint64 LowBits16 = 0x0001000100010001LL;
+static const uint64 HighBits16 = 0x8000800080008000LL;
+
+template <typename T>
+static void fillElements(T* elements, T value, sint32 size) {
+  uint64 pattern = 0;
+  for (uint32 i = 0; i < sizeof(uint64) / sizeof(T); ++i) {
+    memcpy((T*)&pattern + i, &value, sizeof(T));
+  }
+  sint32 perWord = sizeof(uint64) / sizeof(T);
+  sint32 i = 0;
+  for (; i + perWord <= size; i += perWord) {
+    memcpy(elements + i, &pattern, sizeof(uint64));
+  }
+  for (; i < size; ++i) {
+    elements[i] = value;
+  }
+}
+
+// Never throws. The JIT checks that the array is not null.
+extern "C" void j3ArrayFill(JavaObject* array, sint64 value, uint32 logSize) {
+  llvm_gcroot(array, 0);
+  sint32 size = JavaArray::getSize(array);
+  uint8* elements = JavaArray::getElements(array);
+  switch (logSize) {
+    case 0: memset(elements, (uint8)value, size); break;
+    case 1: fillElements((uint16*)elements, (uint16)value, size); break;
+    case 2: fillElements((uint32*)elements, (uint32)value, size); break;
+    default: fillElements((uint64*)elements, (uint64)value, size); break;
+  }
+}
+
+// Never throws.
+extern "C" uint8 j3ArrayEquals(JavaObject* a, JavaObject* b, uint32 logSize) {
+  llvm_gcroot(a, 0);
+  llvm_gcroot(b, 0);
+  if (a == b) return true;
+  if (a == NULL || b == NULL) return false;
+  sint32 size = JavaArray::getSize(a);
+  if (size != JavaArray::getSize(b)) return false;
+  return memcmp(JavaArray::getElements(a), JavaArray::getElements(b),
+                size << logSize) == 0;
+}
+
+// Never throws. The JIT checks that the receiver is not null.
+extern "C" uint8 j3StringEquals(JavaString* self, JavaObject* other) {
+  llvm_gcroot(self, 0);
+  llvm_gcroot(other, 0);
+  if ((JavaObject*)self == other) return true;
+  if (other == NULL) return false;
+  Classpath* upcalls = JavaThread::get()->getJVM()->upcalls;
+  if (JavaObject::getClass(other) != upcalls->newString) return false;
+  JavaString* str = (JavaString*)other;
+  if (self->count != str->count) return false;
+  const uint16* first =
+    ArrayUInt16::getElements(JavaString::getValue(self)) + self->offset;
+  const uint16* second =
+    ArrayUInt16::getElements(JavaString::getValue(str)) + str->offset;
+  return memcmp(first, second, self->count * sizeof(uint16)) == 0;
+}
+
+// Never throws. The JIT checks that the receiver is not null.
+extern "C" sint32 j3StringHashCode(JavaString* self) {
+  llvm_gcroot(self, 0);
+  uint32 hash = self->cachedHashCode;
+  if (hash != 0 || self->count == 0) return hash;
+  const uint16* chars =
+    ArrayUInt16::getElements(JavaString::getValue(self)) + self->offset;
+  sint32 count = self->count;
+  sint32 i = 0;
+  // Consume four characters per iteration with the powers of 31.
+  for (; i + 4 <= count; i += 4) {
+    hash = hash * 923521 + chars[i] * 29791 + chars[i + 1] * 961 +
+           chars[i + 2] * 31 + chars[i + 3];
+  }
+  for (; i < count; ++i) {
+    hash = hash * 31 + chars[i];
+  }
+  self->cachedHashCode = hash;
+  return hash;
+}
+
+// Never throws. The JIT checks that the receiver is not null.
+extern "C" sint32 j3StringIndexOf(JavaString* self, sint32 ch) {
+  llvm_gcroot(self, 0);
+  const uint16* chars =
+    ArrayUInt16::getElements(JavaString::getValue(self)) + self->offset;
+  sint32 count = self->count;
+  if (ch >= 0x10000) {
+    // A supplementary code point is a pair of surrogates.
+    if (ch > 0x10FFFF) return -1;
+    uint16 high = ((ch - 0x10000) >> 10) + 0xD800;
+    uint16 low = ((ch - 0x10000) & 0x3FF) + 0xDC00;
+    for (sint32 i = 0; i + 1 < count; ++i) {
+      if (chars[i] == high && chars[i + 1] == low) return i;
+    }
+    return -1;
+  }
+  if (ch < 0) return -1;
+
+  // Skip the words that have no character equal to ch.
+  uint64 pattern = LowBits16 * (uint16)ch;
+  sint32 i = 0;
+  for (; i + 4 <= count; i += 4) {
+    uint64 word;
+    memcpy(&word, chars + i, sizeof(uint64));
+    word ^= pattern;
+    if ((word - LowBits16) & ~word & HighBits16) break;
+  }
+  for (; i < count; ++i) {
+    if (chars[i] == ch) return i;
+  }
+  return -1;
+}
+
+extern "C" sint64 j3NanoTime() {
+  return vmkit::System::GetNanoTime();
+}
+
 extern "C" void j3ThrowException(JavaObject* obj) {
   llvm_gcroot(obj, 0);
   JavaThread::get()->throwException(obj);
   UNREACHABLE();
 }
 
+// The runtime exception functions below key their fast throw slot on the
+// return address into the compiled code that calls them, the throw site.
+
 extern "C" JavaObject* j3NullPointerException() {
-  return JavaThread::get()->getJVM()->CreateNullPointerException();
+  JavaObject* obj = NULL;
+  llvm_gcroot(obj, 0);
+  Jnjvm* vm = JavaThread::get()->getJVM();
+  obj = vm->getFastThrowException(Jnjvm::FastNullPointerException,
+                                  (word_t)__builtin_return_address(0));
+  if (obj == NULL) obj = vm->CreateNullPointerException();
+  return obj;
 }
 
 extern "C" JavaObject* j3NegativeArraySizeException(sint32 val) {
-  return JavaThread::get()->getJVM()->CreateNegativeArraySizeException();
+  JavaObject* obj = NULL;
+  llvm_gcroot(obj, 0);
+  Jnjvm* vm = JavaThread::get()->getJVM();
+  obj = vm->getFastThrowException(Jnjvm::FastNegativeArraySizeException,
+                                  (word_t)__builtin_return_address(0));
+  if (obj == NULL) obj = vm->CreateNegativeArraySizeException();
+  return obj;
 }
 
 extern "C" JavaObject* j3OutOfMemoryError(sint32 val) {
@@ -323,24 +462,48 @@ extern "C" JavaObject* j3StackOverflowError() {
 }
 
 extern "C" JavaObject* j3ArithmeticException() {
-  return JavaThread::get()->getJVM()->CreateArithmeticException();
+  JavaObject* obj = NULL;
+  llvm_gcroot(obj, 0);
+  Jnjvm* vm = JavaThread::get()->getJVM();
+  obj = vm->getFastThrowException(Jnjvm::FastArithmeticException,
+                                  (word_t)__builtin_return_address(0));
+  if (obj == NULL) obj = vm->CreateArithmeticException();
+  return obj;
 }
 
 extern "C" JavaObject* j3ClassCastException(JavaObject* obj,
                                             UserCommonClass* cl) {
-  llvm_gcroot(obj, 0);  
-  return JavaThread::get()->getJVM()->CreateClassCastException(obj, cl);
+  JavaObject* exc = NULL;
+  llvm_gcroot(obj, 0);
+  llvm_gcroot(exc, 0);
+  Jnjvm* vm = JavaThread::get()->getJVM();
+  exc = vm->getFastThrowException(Jnjvm::FastClassCastException,
+                                  (word_t)__builtin_return_address(0));
+  if (exc == NULL) exc = vm->CreateClassCastException(obj, cl);
+  return exc;
 }
 
 extern "C" JavaObject* j3IndexOutOfBoundsException(JavaObject* obj,
                                                    sint32 index) {
+  JavaObject* exc = NULL;
   llvm_gcroot(obj, 0);
-  return JavaThread::get()->getJVM()->CreateIndexOutOfBoundsException(index);
+  llvm_gcroot(exc, 0);
+  Jnjvm* vm = JavaThread::get()->getJVM();
+  exc = vm->getFastThrowException(Jnjvm::FastIndexOutOfBoundsException,
+                                  (word_t)__builtin_return_address(0));
+  if (exc == NULL) exc = vm->CreateIndexOutOfBoundsException(index);
+  return exc;
 }
 
 extern "C" JavaObject* j3ArrayStoreException(JavaVirtualTable* VT,
                                              JavaVirtualTable* VT2) {
-  return JavaThread::get()->getJVM()->CreateArrayStoreException(VT);
+  JavaObject* obj = NULL;
+  llvm_gcroot(obj, 0);
+  Jnjvm* vm = JavaThread::get()->getJVM();
+  obj = vm->getFastThrowException(Jnjvm::FastArrayStoreException,
+                                  (word_t)__builtin_return_address(0));
+  if (obj == NULL) obj = vm->CreateArrayStoreException(VT);
+  return obj;
 }
 
 // Create an exception then throws it.
@@ -408,18 +571,12 @@ extern "C" void* j3ResolveVirtualStub(JavaObject* obj) {
   
   if (isInterface(origMeth->classDef->access)) {
     InterfaceMethodTable* IMT = cl->virtualVT->IMT;
-    uint32_t index = InterfaceMethodTable::getIndex(Virt->name, Virt->type);
-    if ((IMT->contents[index] & 1) == 0) {
-      IMT->contents[index] = (word_t)result;
-    } else { 
-      JavaMethod* Imeth = 
-        ctpCl->asClass()->lookupInterfaceMethodDontThrow(utf8, sign->keyName);
-      assert(Imeth && "Method not in hierarchy?");
-      word_t* table = (word_t*)(IMT->contents[index] & ~1);
-      uint32 i = 0;
-      while (table[i] != (word_t)Imeth) { i += 2; }
-      table[i + 1] = (word_t)result;
-    }
+    uint32_t selector =
+      InterfaceMethodTable::getSelector(Virt->name, Virt->type);
+    JavaMethod* Imeth = 
+      ctpCl->asClass()->lookupInterfaceMethodDontThrow(utf8, sign->keyName);
+    assert(Imeth && "Method not in hierarchy?");
+    *(IMT->getEntry(Imeth, selector)) = (word_t)result;
   }
 
   return result;
@@ -500,18 +657,9 @@ extern "C" void* j3ResolveSpecialStub() {
 }
 
 // Does not throw an exception.
-extern "C" void* j3ResolveInterface(JavaObject* obj, JavaMethod* meth, uint32_t index) {
-  word_t result = NULL;
+extern "C" void* j3ResolveInterface(JavaObject* obj, JavaMethod* meth, uint32_t selector) {
   InterfaceMethodTable* IMT = JavaObject::getClass(obj)->virtualVT->IMT;
-  if ((IMT->contents[index] & 1) == 0) {
-    result = IMT->contents[index];
-  } else {
-    word_t* table = (word_t*)(IMT->contents[index] & ~1);
-    uint32 i = 0;
-    while (table[i] != (word_t)meth && table[i] != 0) { i += 2; }
-    assert(table[i] != 0);
-    result = table[i + 1];
-  }
+  word_t result = *(IMT->getEntry(meth, selector));
   // TODO(ngeoffray): This code is too performance critical to get asserts.
   // Ideally, it would be inlined by the compiler, so this method is
   // only for debugging.
@@ -519,11 +667,55 @@ extern "C" void* j3ResolveInterface(JavaObject* obj, JavaMethod* meth, uint32_t
   // assert(JavaObject::instanceOf(obj, meth->classDef));
   // assert(meth->classDef->isInterface() ||
   //    (meth->classDef == meth->classDef->classLoader->bootstrapLoader->upcalls->OfObject));
-  // assert(index == InterfaceMethodTable::getIndex(meth->name, meth->type));
+  // assert(selector == InterfaceMethodTable::getSelector(meth->name, meth->type));
   // assert((result != 0) && "Bad IMT");
   return (void*)result;
 }
 
+// Resolves the target of a virtual or interface call whose receiver type is
+// not in the inline cache of the call site, compiling it if needed, and
+// caches it. Abstract methods are not cached: the regular dispatch throws.
+// Once the cache is full, the regular dispatch is used.
+extern "C" void* j3InlineCacheMiss(InlineCache* cache, JavaObject* obj,
+                                   JavaMethod* meth, uint32_t selector) {
+  llvm_gcroot(obj, 0);
+  void* result = NULL;
+  ++cache->misses;
+
+  if (!cache->isMegamorphic()) {
+    UserCommonClass* cl = JavaObject::getClass(obj);
+    UserClass* lookup = cl->isArray() ? cl->super : cl->asClass();
+    JavaMethod* Virt = lookup->lookupMethodDontThrow(meth->name, meth->type,
+                                                     false, true, 0);
+    if (Virt != NULL && !isAbstract(Virt->access)) {
+      result = Virt->compiledPtr(lookup);
+      cache->add((word_t)obj->getVirtualTable(), (word_t)result);
+      return result;
+    }
+  }
+
+  if (isInterface(meth->classDef->access)) {
+    return j3ResolveInterface(obj, meth, selector);
+  } else {
+    return ((void**)obj->getVirtualTable())[meth->offset];
+  }
+}
+
+// Compiles the version of the method that continues the execution of a
+// frame at a loop header. May throw an exception if compiling does.
+extern "C" void* j3CompileOSR(JavaMethod* meth, uint32 index) {
+  return meth->classDef->classLoader->getCompiler()->compileOSR(meth, index);
+}
+
+// Does not throw an exception. Scans the secondary types of a virtual table
+// whose cache does not hold the checked type, and caches it if found.
+extern "C" uint8 j3IsSecondaryType(JavaVirtualTable* VT,
+                                   JavaVirtualTable* otherVT,
+                                   word_t* misses) {
+  if (misses != NULL) ++(*misses);
+  return VT->isSubtypeOf(otherVT);
+}
+
 extern "C" void j3PrintMethodStart(JavaMethod* meth) {
   fprintf(stderr, "[%p] executing %s.%s\n", (void*)vmkit::Thread::get(),
           UTF8Buffer(meth->classDef->name).cString(),
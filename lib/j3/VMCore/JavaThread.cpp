@@ -25,6 +25,8 @@ JavaThread::JavaThread(Jnjvm* isolate) : MutatorThread() {
   jniEnv = isolate->jniEnv;
   localJNIRefs = new JNILocalReferences();
   currentAddedReferences = NULL;
+  globalRefsCache = NULL;
+  globalRefsCacheSize = 0;
   javaThread = NULL;
   vmThread = NULL;
 }
@@ -37,7 +39,9 @@ void JavaThread::initialise(JavaObject* thread, JavaObject* vmth) {
 }
 
 JavaThread::~JavaThread() {
-  delete localJNIRefs;
+  JNILocalReferences* first = localJNIRefs;
+  while (first->prev != NULL) first = first->prev;
+  delete first;
 }
 
 void JavaThread::throwException(JavaObject* obj) {
@@ -132,34 +136,3 @@ void JavaThread::printJavaBacktrace() {
     ++Walker;
   }
 }
-
-JavaObject** JNILocalReferences::addJNIReference(JavaThread* th,
-                                                 JavaObject* obj) {
-  llvm_gcroot(obj, 0);
-  
-  if (length == MAXIMUM_REFERENCES) {
-    JNILocalReferences* next = new JNILocalReferences();
-    th->localJNIRefs = next;
-    next->prev = this;
-    return next->addJNIReference(th, obj);
-  } else {
-    vmkit::Collector::objectReferenceNonHeapWriteBarrier(
-        (gc**)&(localReferences[length]), (gc*)obj);
-    return &localReferences[length++];
-  }
-}
-
-void JNILocalReferences::removeJNIReferences(JavaThread* th, uint32_t num) {
-    
-  if (th->localJNIRefs != this) {
-    delete th->localJNIRefs;
-    th->localJNIRefs = this;
-  }
-
-  if (num > length) {
-    assert(prev && "No prev and deleting too much local references");
-    prev->removeJNIReferences(th, num - length);
-  } else {
-    length -= num;
-  }
-}
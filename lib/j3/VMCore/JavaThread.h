@@ -10,6 +10,8 @@
 #ifndef JNJVM_JAVA_THREAD_H
 #define JNJVM_JAVA_THREAD_H
 
+#include <cerrno>
+
 #include "vmkit/Cond.h"
 #include "vmkit/Locks.h"
 #include "vmkit/ObjectLocks.h"
@@ -54,6 +56,21 @@ class Jnjvm;
   th->enterUncooperativeCode(SP); \
   return; } \
 
+// Surround a system call that may block, e.g. a read on a pipe or a socket,
+// in a BEGIN_JNI_EXCEPTION block. The thread is back in uncooperative code
+// during the call, so that it does not hold up collections, and joins a
+// pending rendezvous when the call returns. The code in between must not
+// use Java objects. errno is preserved.
+#define BEGIN_BLOCKING_CALL \
+  th->endKnownFrame(); \
+  th->enterUncooperativeCode(SP);
+
+#define END_BLOCKING_CALL { \
+  int blockingErrno = errno; \
+  th->leaveUncooperativeCode(); \
+  th->startKnownFrame(Frame); \
+  errno = blockingErrno; }
+
 
 /// JavaThread - This class is the internal representation of a Java thread.
 /// It maintains thread-specific information such as its state, the current
@@ -92,6 +109,15 @@ public:
   ///
   JNILocalReferences* localJNIRefs;
 
+  /// globalRefsCache - Free slots of the JNI global references table taken
+  /// by this thread, linked through the slots.
+  ///
+  JavaObject** globalRefsCache;
+
+  /// globalRefsCacheSize - Number of slots in globalRefsCache.
+  ///
+  uint32_t globalRefsCacheSize;
+
 
   JavaObject** pushJNIRef(JavaObject* obj) {
     llvm_gcroot(obj, 0);
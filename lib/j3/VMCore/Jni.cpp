@@ -2861,16 +2861,58 @@ jsize GetStringLength(JNIEnv *env, jstring _str) {
 }
 
 
-const jchar *GetStringChars(JNIEnv *env, jstring str, jboolean *isCopy) {
-  NYI();
-  abort();
-  return 0;
+const jchar *GetStringChars(JNIEnv *env, jstring _string, jboolean *isCopy) {
+
+  BEGIN_JNI_EXCEPTION
+
+  // Local object references.
+  JavaString* string = *(JavaString**)_string;
+  llvm_gcroot(string, 0);
+  const ArrayUInt16* value = NULL;
+  llvm_gcroot(value, 0);
+
+  value = JavaString::getValue(string);
+  const jchar* chars =
+    (const jchar*)ArrayUInt16::getElements(value) + string->offset;
+
+  // Hand out the characters directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove((gc*)value)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI(chars);
+  }
+
+  if (isCopy) (*isCopy) = true;
+
+  sint32 len = string->count * sizeof(uint16);
+  void* buffer = malloc(len);
+  memcpy(buffer, chars, len);
+
+  RETURN_FROM_JNI((const jchar*)buffer);
+
+  END_JNI_EXCEPTION
+  RETURN_FROM_JNI(0);
 }
 
 
-void ReleaseStringChars(JNIEnv *env, jstring str, const jchar *chars) {
-  NYI();
-  abort();
+void ReleaseStringChars(JNIEnv *env, jstring _string, const jchar *chars) {
+
+  BEGIN_JNI_EXCEPTION
+
+  JavaString* string = *(JavaString**)_string;
+  llvm_gcroot(string, 0);
+  const ArrayUInt16* value = NULL;
+  llvm_gcroot(value, 0);
+
+  // Strings are immutable: only a copy needs to be freed.
+  value = JavaString::getValue(string);
+  const jchar* elements =
+    (const jchar*)ArrayUInt16::getElements(value) + string->offset;
+  if (chars != elements) free((void*)chars);
+
+  END_JNI_EXCEPTION
+
+  RETURN_VOID_FROM_JNI;
 }
 
 
@@ -3191,6 +3233,13 @@ jboolean* GetBooleanArrayElements(JNIEnv *env, jbooleanArray _array,
   ArrayUInt8* array = *(ArrayUInt8**)_array;
   llvm_gcroot(array, 0);
 
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jboolean*)ArrayUInt8::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArrayUInt8::getSize(array) * sizeof(uint8);
@@ -3212,6 +3261,13 @@ jbyte *GetByteArrayElements(JNIEnv *env, jbyteArray _array, jboolean *isCopy) {
   ArraySInt8* array = *(ArraySInt8**)_array;
   llvm_gcroot(array, 0);
 
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jbyte*)ArraySInt8::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArraySInt8::getSize(array) * sizeof(uint8);
@@ -3233,6 +3289,13 @@ jchar *GetCharArrayElements(JNIEnv *env, jcharArray _array, jboolean *isCopy) {
   ArrayUInt16* array = *(ArrayUInt16**)_array;
   llvm_gcroot(array, 0);
 
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jchar*)ArrayUInt16::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArrayUInt16::getSize(array) * sizeof(uint16);
@@ -3255,6 +3318,13 @@ jshort *GetShortArrayElements(JNIEnv *env, jshortArray _array,
   ArraySInt16* array = *(ArraySInt16**)_array;
   llvm_gcroot(array, 0);
   
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jshort*)ArraySInt16::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArraySInt16::getSize(array) * sizeof(sint16);
@@ -3276,6 +3346,13 @@ jint *GetIntArrayElements(JNIEnv *env, jintArray _array, jboolean *isCopy) {
   ArraySInt32* array = *(ArraySInt32**)_array;
   llvm_gcroot(array, 0);
 
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jint*)ArraySInt32::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArraySInt32::getSize(array) * sizeof(sint32);
@@ -3297,6 +3374,13 @@ jlong *GetLongArrayElements(JNIEnv *env, jlongArray _array, jboolean *isCopy) {
   ArrayLong* array = *(ArrayLong**)_array;
   llvm_gcroot(array, 0);
 
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jlong*)ArrayLong::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArrayLong::getSize(array) * sizeof(sint64);
@@ -3319,6 +3403,13 @@ jfloat *GetFloatArrayElements(JNIEnv *env, jfloatArray _array,
   ArrayFloat* array = *(ArrayFloat**)_array;
   llvm_gcroot(array, 0);
 
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jfloat*)ArrayFloat::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArrayFloat::getSize(array) * sizeof(float);
@@ -3341,6 +3432,13 @@ jdouble *GetDoubleArrayElements(JNIEnv *env, jdoubleArray _array,
   ArrayDouble* array = *(ArrayDouble**)_array;
   llvm_gcroot(array, 0);
   
+  // Hand out the elements directly when the collector never moves the
+  // array.
+  if (vmkit::Collector::willNeverMove(array)) {
+    if (isCopy) (*isCopy) = false;
+    RETURN_FROM_JNI((jdouble*)ArrayDouble::getElements(array));
+  }
+
   if (isCopy) (*isCopy) = true;
 
   sint32 len = ArrayDouble::getSize(array) * sizeof(double);
@@ -3361,7 +3459,10 @@ void ReleaseBooleanArrayElements(JNIEnv *env, jbooleanArray _array,
   
   ArrayUInt8* array = *(ArrayUInt8**)_array;
   llvm_gcroot(array, 0);
-  
+
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jboolean*)ArrayUInt8::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3384,7 +3485,10 @@ void ReleaseByteArrayElements(JNIEnv *env, jbyteArray _array, jbyte *elems,
 
   ArraySInt16* array = *(ArraySInt16**)_array;
   llvm_gcroot(array, 0);
-  
+
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jbyte*)ArraySInt16::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3408,6 +3512,9 @@ void ReleaseCharArrayElements(JNIEnv *env, jcharArray _array, jchar *elems,
   ArrayUInt16* array = *(ArrayUInt16**)_array;
   llvm_gcroot(array, 0);
 
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jchar*)ArrayUInt16::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3430,7 +3537,10 @@ void ReleaseShortArrayElements(JNIEnv *env, jshortArray _array, jshort *elems,
 
   ArraySInt16* array = *(ArraySInt16**)_array;
   llvm_gcroot(array, 0);
-  
+
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jshort*)ArraySInt16::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3453,7 +3563,10 @@ void ReleaseIntArrayElements(JNIEnv *env, jintArray _array, jint *elems,
     
   ArraySInt32* array = *(ArraySInt32**)_array;
   llvm_gcroot(array, 0);
-  
+
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jint*)ArraySInt32::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3476,7 +3589,10 @@ void ReleaseLongArrayElements(JNIEnv *env, jlongArray _array, jlong *elems,
     
   ArrayLong* array = *(ArrayLong**)_array;
   llvm_gcroot(array, 0);
-  
+
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jlong*)ArrayLong::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3498,7 +3614,10 @@ void ReleaseFloatArrayElements(JNIEnv *env, jfloatArray _array, jfloat *elems,
     
   ArrayFloat* array = *(ArrayFloat**)_array;
   llvm_gcroot(array, 0);
-  
+
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jfloat*)ArrayFloat::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3521,7 +3640,10 @@ void ReleaseDoubleArrayElements(JNIEnv *env, jdoubleArray _array,
     
   ArrayDouble* array = *(ArrayDouble**)_array;
   llvm_gcroot(array, 0);
-  
+
+  // The elements were handed out directly: there is nothing to copy back.
+  if (elems == (jdouble*)ArrayDouble::getElements(array)) RETURN_VOID_FROM_JNI;
+
   if (mode == JNI_ABORT) {
     free(elems);
   } else {
@@ -3790,6 +3912,12 @@ jint RegisterNatives(JNIEnv *env, jclass _clazz, const JNINativeMethod *methods,
   assert(Cl);
   UserClass * cl = Cl->asClass();
 
+  // Resolve all the methods, and record them at once.
+  vmkit::ThreadAllocator allocator;
+  JavaMethod** meths =
+    (JavaMethod**)allocator.Allocate(nMethods * sizeof(JavaMethod*));
+  word_t* fnPtrs = (word_t*)allocator.Allocate(nMethods * sizeof(word_t));
+
   for(int i = 0; i < nMethods; ++i)
   {
     const UTF8* name = cl->classLoader->hashUTF8->lookupAsciiz(methods[i].name);
@@ -3804,8 +3932,10 @@ jint RegisterNatives(JNIEnv *env, jclass _clazz, const JNINativeMethod *methods,
     assert(meth);
     assert(isNative(meth->access));
 
-    cl->classLoader->registerNative(meth,(word_t)methods[i].fnPtr);
+    meths[i] = meth;
+    fnPtrs[i] = (word_t)methods[i].fnPtr;
   }
+  cl->classLoader->registerNatives(meths, fnPtrs, nMethods);
 
   RETURN_FROM_JNI(0)
 
@@ -3928,18 +4058,17 @@ void GetStringUTFRegion(JNIEnv* env, jstring str, jsize start, jsize len,
 void *GetPrimitiveArrayCritical(JNIEnv *env, jarray _array, jboolean *isCopy) {
   BEGIN_JNI_EXCEPTION
   
-  JavaObject* array = *(JavaObject**)_array;
+  JavaObject* array = NULL;
   llvm_gcroot(array, 0);
 
-  if (isCopy) (*isCopy) = true;
+  if (isCopy) (*isCopy) = false;
 
-  UserClassArray* cl = JavaObject::getClass(array)->asArrayClass();
-  uint32 logSize = cl->baseClass()->asPrimitiveClass()->logSize;
-  sint32 len = JavaArray::getSize(array) << logSize;
-  void* buffer = malloc(len);
-  memcpy(buffer, JavaArray::getElements(array), len);
+  // Collections wait for the release, so that the elements do not move.
+  // Entering the section may join a collection: load the array after.
+  th->getJVM()->rendezvous.enterCritical();
+  array = *(JavaObject**)_array;
 
-  RETURN_FROM_JNI((jchar*)buffer);
+  RETURN_FROM_JNI(JavaArray::getElements(array));
 
   END_JNI_EXCEPTION
   RETURN_FROM_JNI(0);
@@ -3951,19 +4080,8 @@ void ReleasePrimitiveArrayCritical(JNIEnv *env, jarray _array, void *carray,
   
   BEGIN_JNI_EXCEPTION
   
-  JavaObject* array = *(JavaObject**)_array;
-  llvm_gcroot(array, 0);
-
-  if (mode == JNI_ABORT) {
-    free(carray);
-  } else {
-    UserClassArray* cl = JavaObject::getClass(array)->asArrayClass();
-    uint32 logSize = cl->baseClass()->asPrimitiveClass()->logSize;
-    sint32 len = JavaArray::getSize(array) << logSize;
-    memcpy(JavaArray::getElements(array), carray, len);
-
-    if (mode == 0) free(carray);
-  }
+  // The elements were not copied: there is nothing to copy back.
+  th->getJVM()->rendezvous.exitCritical();
   
   END_JNI_EXCEPTION
   
@@ -3971,16 +4089,36 @@ void ReleasePrimitiveArrayCritical(JNIEnv *env, jarray _array, void *carray,
 }
 
 
-const jchar *GetStringCritical(JNIEnv *env, jstring string, jboolean *isCopy) {
-  NYI();
-  abort();
-  return 0;
+const jchar *GetStringCritical(JNIEnv *env, jstring _string, jboolean *isCopy) {
+  BEGIN_JNI_EXCEPTION
+
+  JavaString* string = NULL;
+  llvm_gcroot(string, 0);
+  const ArrayUInt16* value = NULL;
+  llvm_gcroot(value, 0);
+
+  if (isCopy) (*isCopy) = false;
+
+  th->getJVM()->rendezvous.enterCritical();
+  string = *(JavaString**)_string;
+  value = JavaString::getValue(string);
+
+  RETURN_FROM_JNI((const jchar*)ArrayUInt16::getElements(value) +
+                  string->offset);
+
+  END_JNI_EXCEPTION
+  RETURN_FROM_JNI(0);
 }
 
 
-void ReleaseStringCritical(JNIEnv *env, jstring string, const jchar *cstring) {
-  NYI();
-  abort();
+void ReleaseStringCritical(JNIEnv *env, jstring _string, const jchar *cstring) {
+  BEGIN_JNI_EXCEPTION
+
+  th->getJVM()->rendezvous.exitCritical();
+
+  END_JNI_EXCEPTION
+
+  RETURN_VOID_FROM_JNI;
 }
 
 
@@ -4009,12 +4147,8 @@ jobject NewGlobalRef(JNIEnv* env, jobject obj) {
     Obj = *(JavaObject**)obj;
     llvm_gcroot(Obj, 0);
 
-    Jnjvm* vm = JavaThread::get()->getJVM();
-
-
-    vm->globalRefsLock.lock();
-    JavaObject** res = vm->globalRefs.addJNIReference(Obj);
-    vm->globalRefsLock.unlock();
+    Jnjvm* vm = th->getJVM();
+    JavaObject** res = vm->globalRefs.addJNIReference(th, Obj);
 
     RETURN_FROM_JNI((jobject)res);
   } else {
@@ -4030,10 +4164,10 @@ void DeleteGlobalRef(JNIEnv* env, jobject globalRef) {
   
   BEGIN_JNI_EXCEPTION
   
-  Jnjvm* vm = myVM(env);
-  vm->globalRefsLock.lock();
-  vm->globalRefs.removeJNIReference((JavaObject**)globalRef);
-  vm->globalRefsLock.unlock();
+  if (globalRef != NULL) {
+    Jnjvm* vm = myVM(env);
+    vm->globalRefs.removeJNIReference(th, (JavaObject**)globalRef);
+  }
   
   END_JNI_EXCEPTION
   
@@ -35,6 +35,7 @@
 #include "LockedMap.h"
 #include "Reader.h"
 #include "ReferenceQueue.h"
+#include "StartupProfile.h"
 #include "VMStaticInstance.h"
 #include "Zip.h"
 
@@ -118,6 +119,11 @@ void UserClass::initialiseClass(Jnjvm* vm) {
     setOwnerClass(self);
     setInitializationState(inClinit);
     UserClass* cl = (UserClass*)this;
+
+    StartupProfile* recorder = StartupProfile::recorder;
+    if (recorder) {
+      recorder->recordClass(StartupProfile::Initialise, cl);
+    }
     
     // Single environment allocates the static instance during resolution, so
     // that compiled code can access it directly (with an initialization
@@ -383,6 +389,83 @@ JavaObject* Jnjvm::CreateClassCastException(JavaObject* obj,
                      (JavaString*)0);
 }
 
+static const char* fastThrowClassNames[Jnjvm::NumFastThrowKinds] = {
+  "java.lang.NullPointerException",
+  "java.lang.ArithmeticException",
+  "java.lang.ArrayIndexOutOfBoundsException",
+  "java.lang.ClassCastException",
+  "java.lang.NegativeArraySizeException",
+  "java.lang.ArrayStoreException"
+};
+
+void Jnjvm::disableFastThrow(const char* className) {
+  for (uint32 i = 0; i < NumFastThrowKinds; ++i) {
+    if (!strcmp(className, fastThrowClassNames[i])) {
+      fastThrowKinds &= ~(1 << i);
+      return;
+    }
+  }
+  fprintf(stderr, "Fast throws are not supported for %s\n", className);
+}
+
+JavaObject* Jnjvm::getFastThrowException(FastThrowKind kind, word_t ip) {
+  JavaObject* obj = NULL;
+  llvm_gcroot(obj, 0);
+
+  if (fastThrowThreshold == 0 || (fastThrowKinds & (1 << kind)) == 0) {
+    return NULL;
+  }
+
+  // The slots are updated without synchronization: a lost update only
+  // delays the time the site becomes hot.
+  FastThrowSite* site = &fastThrowSites[(ip >> 2) & (FastThrowSitesSize - 1)];
+  if (site->ip != ip) {
+    site->ip = ip;
+    site->count = 1;
+    return NULL;
+  } else if (site->count < fastThrowThreshold) {
+    ++site->count;
+    return NULL;
+  }
+
+  obj = fastThrowExceptions[kind];
+  if (obj != NULL) return obj;
+
+  // The exception is shared by all the sites: it has no message that
+  // depends on the site, and no stack trace.
+  switch (kind) {
+    case FastNullPointerException:
+      obj = CreateNullPointerException();
+      break;
+    case FastArithmeticException:
+      obj = CreateArithmeticException();
+      break;
+    case FastIndexOutOfBoundsException:
+      obj = CreateError(upcalls->ArrayIndexOutOfBoundsException,
+                        upcalls->InitArrayIndexOutOfBoundsException,
+                        (JavaString*)0);
+      break;
+    case FastClassCastException:
+      obj = CreateClassCastException(NULL, NULL);
+      break;
+    case FastNegativeArraySizeException:
+      obj = CreateNegativeArraySizeException();
+      break;
+    case FastArrayStoreException:
+      obj = CreateArrayStoreException(NULL);
+      break;
+    default:
+      UNREACHABLE();
+  }
+  JavaObjectThrowable::clearStackTrace((JavaObjectThrowable*)obj);
+
+  // Threads racing to allocate the exception all throw their own, and the
+  // last one is kept.
+  vmkit::Collector::objectReferenceNonHeapWriteBarrier(
+      (gc**)&(fastThrowExceptions[kind]), (gc*)obj);
+  return obj;
+}
+
 JavaObject* Jnjvm::CreateLinkageError(const char* msg) {
   JavaString* str = NULL;
   llvm_gcroot(str, 0);
@@ -929,11 +1012,26 @@ void ClArgumentsInfo::printInformation() {
     "-agentpath:<pathname>[=<options>]\n"
     "              load native agent library by full pathname\n"
     "-javaagent:<jarpath>[=<options>]\n"
-    "       load Java programming language agent, see java.lang.instrument\n");
+    "       load Java programming language agent, see java.lang.instrument\n"
+    "-Xrecord-startup:<file>[,<seconds>]\n"
+    "              record the classes loaded and the methods compiled during\n"
+    "              the first seconds of the run (default 10) in <file>\n"
+    "-Xreplay-startup:<file>\n"
+    "              load and compile in the background what <file> recorded\n"
+    "-Xmax-stack-trace-depth:<n>\n"
+    "              report at most <n> frames in the stack trace of a\n"
+    "              throwable, 0 to capture no stack trace\n"
+    "-Xfast-throw:<n>\n"
+    "              share a preallocated exception without stack trace at the\n"
+    "              compiled throw sites that threw <n> times (default 0, off)\n"
+    "-Xno-fast-throw:<class>\n"
+    "              never share preallocated exceptions of the given class,\n"
+    "              e.g. java.lang.NullPointerException\n");
 }
 
 void ClArgumentsInfo::readArgs(Jnjvm* vm) {
   className = 0;
+  replayStartupFile = 0;
   appArgumentsPos = 0;
   sint32 i = 1;
   if (i == argc) printInformation();
@@ -970,6 +1068,36 @@ void ClArgumentsInfo::readArgs(Jnjvm* vm) {
         char* path = &cur[16];
         vm->bootstrapLoader->analyseClasspathEnv(path);
       }
+    } else if (!(strncmp(cur, "-Xrecord-startup:", 17))) {
+      if (strlen(cur) == 17) {
+        printInformation();
+      } else {
+        StartupProfile::startRecording(vm, &cur[17]);
+      }
+    } else if (!(strncmp(cur, "-Xreplay-startup:", 17))) {
+      if (strlen(cur) == 17) {
+        printInformation();
+      } else {
+        replayStartupFile = &cur[17];
+      }
+    } else if (!(strncmp(cur, "-Xmax-stack-trace-depth:", 24))) {
+      if (strlen(cur) == 24) {
+        printInformation();
+      } else {
+        vm->maxStackTraceDepth = atoi(&cur[24]);
+      }
+    } else if (!(strncmp(cur, "-Xfast-throw:", 13))) {
+      if (strlen(cur) == 13) {
+        printInformation();
+      } else {
+        vm->fastThrowThreshold = atoi(&cur[13]);
+      }
+    } else if (!(strncmp(cur, "-Xno-fast-throw:", 16))) {
+      if (strlen(cur) == 16) {
+        printInformation();
+      } else {
+        vm->disableFastThrow(&cur[16]);
+      }
     } else if (!(strcmp(cur, "-enableassertions"))) {
       nyi();
     } else if (!(strcmp(cur, "-ea"))) {
@@ -1268,6 +1396,10 @@ void Jnjvm::mainJavaStart(JavaThread* thread) {
         UTF8Buffer(JavaObject::getClass(exc)->name).cString());
   } else {
     ClArgumentsInfo& info = vm->argumentsInfo;
+
+    if (info.replayStartupFile) {
+      StartupReplayThread::startReplay(vm, info.replayStartupFile);
+    }
   
     if (info.agents.size()) {
       assert(0 && "implement me");
@@ -1317,6 +1449,11 @@ Jnjvm::Jnjvm(vmkit::BumpPtrAllocator& Alloc,
 
   classpath = getenv("CLASSPATH");
   if (classpath == NULL) classpath = ".";
+  maxStackTraceDepth = ~0;
+  fastThrowThreshold = 0;
+  fastThrowKinds = (1 << NumFastThrowKinds) - 1;
+  memset(fastThrowSites, 0, sizeof(fastThrowSites));
+  memset(fastThrowExceptions, 0, sizeof(fastThrowExceptions));
   
   appClassLoader = NULL;
   jniEnv = &JNI_JNIEnvTable;
@@ -1424,6 +1561,17 @@ const char* Jnjvm::getObjectTypeName(gc* object) {
   }
 }
 
+void Jnjvm::biasRevoked(gc* object) {
+  // Nothing is allocated here: the object does not move.
+  JavaObject* src = (JavaObject*)object;
+  if (VMClassLoader::isVMClassLoader(src) ||
+      VMStaticInstance::isVMStaticInstance(src)) {
+    return;
+  }
+  CommonClass* cl = JavaObject::getClass(src);
+  if (cl->isClass()) cl->asClass()->biasRevoked();
+}
+
 // Helper function to run J3 without JIT.
 extern "C" int StartJnjvmWithoutJIT(int argc, char** argv, char* mainClass) {
   vmkit::Collector::initialise(argc, argv);
@@ -92,6 +92,7 @@ public:
   uint32 appArgumentsPos;
   char* className;
   char* jarFile;
+  char* replayStartupFile;
   std::vector< std::pair<char*, char*> > agents;
 
   void readArgs(Jnjvm *vm);
@@ -131,6 +132,7 @@ private:
   virtual void addFinalizationCandidate(gc* obj);
   virtual size_t getObjectSize(gc* obj);
   virtual const char* getObjectTypeName(gc* obj);
+  virtual void biasRevoked(gc* obj);
   virtual void printMethod(vmkit::FrameInfo* FI, word_t ip, word_t addr);
 
 
@@ -232,13 +234,79 @@ public:
   ///
   const char* classpath;
 
-  /// globalRefs - Global references that JNI wants to protect.
+  /// maxStackTraceDepth - The maximum number of frames reported in the
+  /// stack trace of a throwable.
   ///
-  JNIGlobalReferences globalRefs;
+  uint32 maxStackTraceDepth;
+
+  /// StackTraceMargin - The number of frames captured beyond
+  /// maxStackTraceDepth, for the frames of fillInStackTrace, of the
+  /// constructors of the throwable and of the VM that are not reported.
+  ///
+  static const uint32 StackTraceMargin = 16;
+
+  /// getStackTraceCaptureLength - The number of frames fillInStackTrace
+  /// captures out of the given number of frames on the stack.
+  ///
+  uint32 getStackTraceCaptureLength(uint32 length) {
+    if (maxStackTraceDepth == 0) return 0;
+    if (length > StackTraceMargin &&
+        length - StackTraceMargin > maxStackTraceDepth) {
+      return maxStackTraceDepth + StackTraceMargin;
+    }
+    return length;
+  }
 
-  /// globalRefsLock - Lock for adding a new global reference.
+  /// FastThrowKind - The runtime exceptions of compiled code that hot throw
+  /// sites may share.
   ///
-  vmkit::LockNormal globalRefsLock;
+  enum FastThrowKind {
+    FastNullPointerException,
+    FastArithmeticException,
+    FastIndexOutOfBoundsException,
+    FastClassCastException,
+    FastNegativeArraySizeException,
+    FastArrayStoreException,
+    NumFastThrowKinds
+  };
+
+  /// FastThrowSite - The number of exceptions created at a throw site since
+  /// it took its slot.
+  ///
+  struct FastThrowSite {
+    word_t ip;
+    uint32 count;
+  };
+
+  /// FastThrowSitesSize - The number of slots counting throw sites. Sites
+  /// whose IPs hash to the same slot take it from each other.
+  ///
+  static const uint32 FastThrowSitesSize = 1024;
+
+  /// fastThrowThreshold - The number of exceptions a throw site creates
+  /// before throwing the shared exception of its kind. Zero disables fast
+  /// throws.
+  ///
+  uint32 fastThrowThreshold;
+
+  /// fastThrowKinds - The set of the kinds whose throw sites may become hot,
+  /// one bit per kind.
+  ///
+  uint32 fastThrowKinds;
+
+  /// fastThrowSites - The counts of the throw sites.
+  ///
+  FastThrowSite fastThrowSites[FastThrowSitesSize];
+
+  /// fastThrowExceptions - The shared exceptions of each kind. They have no
+  /// stack trace and are allocated when the first site of their kind
+  /// becomes hot.
+  ///
+  JavaObject* fastThrowExceptions[NumFastThrowKinds];
+
+  /// globalRefs - Global references that JNI wants to protect.
+  ///
+  JNIGlobalReferences globalRefs;
   
   /// appClassLoader - The bootstrap class loader.
   ///
@@ -259,6 +327,17 @@ public:
   JavaObject* CreateLinkageError(const char* msg);
   JavaObject* CreateArrayStoreException(JavaVirtualTable* VT);
   JavaObject* CreateUnsatisfiedLinkError(JavaMethod* meth);
+
+  /// getFastThrowException - Get the shared exception of the given kind if
+  /// the throw site at the given IP is hot, or null if the site must create
+  /// its exception.
+  ///
+  JavaObject* getFastThrowException(FastThrowKind kind, word_t ip);
+
+  /// disableFastThrow - Never share the exceptions of the given class, e.g.
+  /// java.lang.NullPointerException.
+  ///
+  void disableFastThrow(const char* className);
   
   /// Exceptions - These are the only exceptions VMKit will make.
   ///
@@ -26,6 +26,7 @@
 #include "debug.h"
 #include "vmkit/Allocator.h"
 
+#include "ClassHierarchy.h"
 #include "Classpath.h"
 #include "ClasspathReflect.h"
 #include "JavaClass.h"
@@ -39,6 +40,7 @@
 #include "JnjvmClassLoader.h"
 #include "LockedMap.h"
 #include "Reader.h"
+#include "StartupProfile.h"
 #include "Zip.h"
 
 
@@ -66,6 +68,9 @@ JnjvmBootstrapLoader::JnjvmBootstrapLoader(vmkit::BumpPtrAllocator& Alloc,
    
   upcalls = new(allocator, "Classpath") Classpath();
   bootstrapLoader = this;
+  // The self handle only names the global scope for dlsym: open the
+  // program itself to read its symbol table.
+  selfLibrary = new NativeLibrary(dlopen(NULL, RTLD_LAZY));
    
   // Try to find if we have a pre-compiled rt.jar
   bool bootLoaded = false;
@@ -170,7 +175,12 @@ JnjvmBootstrapLoader::JnjvmBootstrapLoader(vmkit::BumpPtrAllocator& Alloc,
   mathName = asciizConstructUTF8("java/lang/Math");
   VMFloatName = asciizConstructUTF8("java/lang/VMFloat");
   VMDoubleName = asciizConstructUTF8("java/lang/VMDouble");
+  floatName = asciizConstructUTF8("java/lang/Float");
+  doubleName = asciizConstructUTF8("java/lang/Double");
   stackWalkerName = asciizConstructUTF8("gnu/classpath/VMStackWalker");
+  arraysName = asciizConstructUTF8("java/util/Arrays");
+  systemName = asciizConstructUTF8("java/lang/System");
+  VMSystemName = asciizConstructUTF8("java/lang/VMSystem");
   NoClassDefFoundError = asciizConstructUTF8("java/lang/NoClassDefFoundError");
 
 #define DEF_UTF8(var) \
@@ -204,6 +214,11 @@ JnjvmBootstrapLoader::JnjvmBootstrapLoader(vmkit::BumpPtrAllocator& Alloc,
   DEF_UTF8(doubleToRawLongBits);
   DEF_UTF8(intBitsToFloat);
   DEF_UTF8(longBitsToDouble);
+  DEF_UTF8(fill);
+  DEF_UTF8(equals);
+  DEF_UTF8(hashCode);
+  DEF_UTF8(indexOf);
+  DEF_UTF8(nanoTime);
 
 #undef DEF_UTF8 
 }
@@ -367,6 +382,11 @@ UserClass* JnjvmClassLoader::loadName(const UTF8* name, bool doResolve,
 
   ensureCached(cl);
 
+  StartupProfile* recorder = StartupProfile::recorder;
+  if (cl && cl->isClass() && recorder) {
+    recorder->recordClass(StartupProfile::Load, cl);
+  }
+
   return cl;
 }
 
@@ -607,6 +627,7 @@ UserClass* JnjvmClassLoader::constructClass(const UTF8* name,
       res = new(allocator, "Class") UserClass(this, internalName, bytes);
       res->readClass();
       res->makeVT();
+      ClassHierarchy::addClass(res);
       getCompiler()->resolveVirtualClass(res);
       getCompiler()->resolveStaticClass(res);
       classes->lock.lock();
@@ -861,9 +882,10 @@ JnjvmClassLoader::~JnjvmClassLoader() {
     allocator.Deallocate(javaSignatures);
   }
 
-  for (std::vector<void*>::iterator i = nativeLibs.begin(); 
+  for (std::vector<NativeLibrary*>::iterator i = nativeLibs.begin(); 
        i < nativeLibs.end(); ++i) {
-    dlclose(*i);
+    dlclose((*i)->handle);
+    delete *i;
   }
 
   delete TheCompiler;
@@ -971,29 +993,39 @@ const UTF8* JnjvmClassLoader::constructArrayName(uint32 steps,
   return res;
 }
 
+word_t JnjvmClassLoader::lookupInLibs(const char* buf, bool dependencies) {
+  for (std::vector<NativeLibrary*>::iterator i = nativeLibs.begin(),
+      e = nativeLibs.end(); i!= e; ++i) {
+    word_t sym = (*i)->lookup(TheCompiler, buf);
+    if (sym) return sym;
+  }
+
+  // The indexes only hold the functions defined by the libraries themselves.
+  // Look for the function in the libraries they depend on.
+  if (dependencies) {
+    for (std::vector<NativeLibrary*>::iterator i = nativeLibs.begin(),
+        e = nativeLibs.end(); i!= e; ++i) {
+      word_t sym = (*i)->lookupInDependencies(TheCompiler, buf);
+      if (sym) return sym;
+    }
+  }
+  return 0;
+}
+
 word_t JnjvmClassLoader::loadInLib(const char* buf, bool& j3) {
-  // Check 'self'.  Should only check our process, however it's possible native
-  // code dlopen'd something itself (with RTLD_GLOBAL; OpenJDK does this).
-  // To handle this, we search both ourselves and the libraries we loaded.
-  word_t sym =
-    (word_t)TheCompiler->loadMethod(vmkit::System::GetSelfHandle(), buf);
+  // Check 'self', whose JNI functions are indexed like those of the
+  // libraries.
+  NativeLibrary* self = bootstrapLoader->selfLibrary;
+  word_t sym = self->lookup(TheCompiler, buf);
 
   // Search loaded libraries as well, both as fallback and to determine
   // whether or not the symbol in question is defined by vmkit.
-  word_t symFromLib = 0;
-  for (std::vector<void*>::iterator i = nativeLibs.begin(),
-      e = nativeLibs.end(); i!= e; ++i) {
-    symFromLib = (word_t)TheCompiler->loadMethod((*i), buf);
-    if (symFromLib) break;
-  }
+  word_t symFromLib = lookupInLibs(buf, sym == 0);
 
   if (sym) {
     // Always use the definition from 'self', if it exists.
     // Furthermore, claim it's defined in j3 iff it wasn't found in one of our
-    // libraries.  This might be wrong if we do a lookup on a symbol that's
-    // neither in vmkit nor a VM-loaded library (but /is/ in a different library
-    // that has been dlopen'd by native code), but that should never
-    // be called from java code anyway.
+    // libraries.
     j3 = (sym != symFromLib);
     return sym;
   }
@@ -1001,15 +1033,25 @@ word_t JnjvmClassLoader::loadInLib(const char* buf, bool& j3) {
   // Otherwise return what we found in the libraries, if anything
   if (symFromLib) return symFromLib;
 
-  if (this != bootstrapLoader)
-    return bootstrapLoader->loadInLib(buf, j3);
+  if (this != bootstrapLoader) {
+    symFromLib = bootstrapLoader->lookupInLibs(buf, true);
+    if (symFromLib) return symFromLib;
+  }
 
-  return 0;
+  // Native code may have dlopen'd something itself (with RTLD_GLOBAL; OpenJDK
+  // does this): search the whole process before giving up. This might claim
+  // a symbol that is neither in vmkit nor in a VM-loaded library is defined
+  // in j3, but such a symbol should never be called from java code anyway.
+  // If 'self' is not indexed, its lookup already searched the process.
+  if (!self->isIndexed()) return 0;
+  sym = (word_t)TheCompiler->loadMethod(vmkit::System::GetSelfHandle(), buf);
+  if (sym) j3 = true;
+  return sym;
 }
 
 void* JnjvmClassLoader::loadLib(const char* buf) {
   void* handle = dlopen(buf, RTLD_LAZY | RTLD_LOCAL);
-  if (handle) nativeLibs.push_back(handle);
+  if (handle) nativeLibs.push_back(new NativeLibrary(handle));
   return handle;
 }
 
@@ -1037,6 +1079,25 @@ word_t JnjvmClassLoader::nativeLookup(JavaMethod* meth, bool& j3,
   return res;
 }
 
+word_t JnjvmClassLoader::criticalNativeLookup(JavaMethod* meth, char* buf) {
+  // A method defined via registerNatives() uses that definition.
+  if (getRegisteredNative(meth) != 0) return 0;
+
+  // Construct the JNI name after the difference of length of the prefixes,
+  // and replace its prefix.
+  const uint32 shift = JNI_CRITICAL_NAME_PRE_LEN - JNI_NAME_PRE_LEN;
+  bool j3 = false;
+  meth->jniConsFromMeth(buf + shift);
+  memcpy(buf, JNI_CRITICAL_NAME_PRE, JNI_CRITICAL_NAME_PRE_LEN);
+  word_t res = loadInLib(buf, j3);
+  if (!res) {
+    meth->jniConsFromMethOverloaded(buf + shift);
+    memcpy(buf, JNI_CRITICAL_NAME_PRE, JNI_CRITICAL_NAME_PRE_LEN);
+    res = loadInLib(buf, j3);
+  }
+  return res;
+}
+
 
 JavaString** StringList::addString(JnjvmClassLoader* JCL, JavaString* obj) {
   llvm_gcroot(obj, 0);
@@ -1056,18 +1117,21 @@ JavaString** StringList::addString(JnjvmClassLoader* JCL, JavaString* obj) {
   }
 }
 
-void JnjvmClassLoader::registerNative(JavaMethod * meth, word_t fnPtr) {
+void JnjvmClassLoader::registerNatives(JavaMethod** meths, word_t* fnPtrs,
+                                       uint32 nb) {
   nativesLock.lock();
-  // Don't support multiple levels of registerNatives
-  assert(registeredNatives.find(meth) == registeredNatives.end());
-
-  registeredNatives[meth] = fnPtr;
+  for (uint32 i = 0; i < nb; ++i) {
+    registeredNatives[meths[i]] = fnPtrs[i];
+  }
   nativesLock.unlock();
 }
 
 word_t JnjvmClassLoader::getRegisteredNative(const JavaMethod * meth) {
+  word_t res = 0;
   nativesLock.lock();
-  word_t res = registeredNatives[meth];
+  llvm::DenseMap<const JavaMethod*, word_t>::iterator I =
+    registeredNatives.find(meth);
+  if (I != registeredNatives.end()) res = I->second;
   nativesLock.unlock();
   return res;
 }
@@ -19,9 +19,11 @@
 
 
 #include "vmkit/Allocator.h"
+#include "llvm/ADT/DenseMap.h"
 
 #include "JavaObject.h"
 #include "JnjvmConfig.h"
+#include "NativeLibrary.h"
 #include "UTF8.h"
 
 namespace j3 {
@@ -117,7 +119,7 @@ protected:
   /// registeredNatives - Stores the native function pointers corresponding
   /// to methods that were defined through JNI's RegisterNatives mechanism.
   ///
-  std::map<const JavaMethod*,word_t> registeredNatives;
+  llvm::DenseMap<const JavaMethod*, word_t> registeredNatives;
 
   /// nativesLock - Locks the registeredNatives map above
   ///
@@ -275,7 +277,13 @@ public:
   
   /// nativeLibs - Native libraries (e.g. '.so') loaded by this class loader.
   ///
-  std::vector<void*> nativeLibs;
+  std::vector<NativeLibrary*> nativeLibs;
+
+  /// lookupInLibs - Look up a native function in the indexes of the native
+  /// libraries loaded by this class loader and, if it is not found and
+  /// dependencies is true, in the libraries they depend on.
+  ///
+  word_t lookupInLibs(const char* buf, bool dependencies);
 
   /// loadInLib - Loads a native function out of the native libraries loaded
   /// by this class loader. The last argument tells if the returned method
@@ -297,6 +305,13 @@ public:
   ///
   word_t nativeLookup(JavaMethod* meth, bool& j3, char* buf);
 
+  /// criticalNativeLookup - Lookup in the libraries the critical version of
+  /// the native method, named with the JavaCritical_ prefix. It takes no
+  /// JNI environment nor class, and gets each array as its length and a
+  /// pointer to its elements. The buffer holds names with that prefix.
+  ///
+  word_t criticalNativeLookup(JavaMethod* meth, char* buf);
+
   /// insertAllMethodsInVM - Insert all methods defined by this class loader
   /// in the VM.
   ///
@@ -316,9 +331,10 @@ public:
   ///
   Class* loadClassFromSelf(Jnjvm* vm, const char* name);
 
-  /// registerNative - Record the native function pointer of a method.
+  /// registerNatives - Record the native function pointers of methods. A
+  /// method registered again takes the new pointer.
   ///
-  void registerNative(JavaMethod * meth, word_t fnPtr);
+  void registerNatives(JavaMethod** meths, word_t* fnPtrs, uint32 nb);
 
   /// getRegisteredNative - Return the native pointer, if exists.
   ///
@@ -385,6 +401,11 @@ public:
   /// Java code.
   ///
   Classpath* upcalls;
+
+  /// selfLibrary - The JNI functions exported by the VM itself, indexed
+  /// once like those of the native libraries.
+  ///
+  NativeLibrary* selfLibrary;
   
   /// Lists of UTF8s used internaly in VMKit.
   const UTF8* NoClassDefFoundError;
@@ -398,7 +419,12 @@ public:
   const UTF8* mathName;
   const UTF8* VMFloatName;
   const UTF8* VMDoubleName;
+  const UTF8* floatName;
+  const UTF8* doubleName;
   const UTF8* stackWalkerName;
+  const UTF8* arraysName;
+  const UTF8* systemName;
+  const UTF8* VMSystemName;
   const UTF8* abs;
   const UTF8* sqrt;
   const UTF8* sin;
@@ -427,6 +453,11 @@ public:
   const UTF8* doubleToRawLongBits;
   const UTF8* intBitsToFloat;
   const UTF8* longBitsToDouble;
+  const UTF8* fill;
+  const UTF8* equals;
+  const UTF8* hashCode;
+  const UTF8* indexOf;
+  const UTF8* nanoTime;
 
   /// primitiveMap - Map of primitive classes, hashed by id.
   std::map<const char, UserClassPrimitive*> primitiveMap;
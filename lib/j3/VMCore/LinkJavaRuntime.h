@@ -14,6 +14,7 @@
 
 namespace j3 {
   class JavaObject;
+  class JavaString;
   class UserClass;
   class UserClassArray;
   class UserCommonClass;
@@ -44,6 +45,16 @@ extern "C" void j3EndJNI(uint32**);
 extern "C" void* j3StartJNI(uint32*, uint32**, vmkit::KnownFrame*);
 extern "C" void j3JavaObjectAquire(JavaObject* obj);
 extern "C" void j3JavaObjectRelease(JavaObject* obj);
+extern "C" void j3ArrayFill(JavaObject* array, sint64 value, uint32 logSize);
+extern "C" uint8 j3ArrayEquals(JavaObject* a, JavaObject* b, uint32 logSize);
+extern "C" uint8 j3StringEquals(JavaString* self, JavaObject* other);
+extern "C" sint32 j3StringHashCode(JavaString* self);
+extern "C" sint32 j3StringIndexOf(JavaString* self, sint32 ch);
+extern "C" sint64 j3NanoTime();
+extern "C" void* j3CompileOSR(JavaMethod* meth, uint32 index);
+extern "C" uint8 j3IsSecondaryType(JavaVirtualTable* VT,
+                                   JavaVirtualTable* otherVT,
+                                   word_t* misses);
 extern "C" void j3ThrowException(JavaObject* obj);
 extern "C" JavaObject* j3NullPointerException();
 extern "C" JavaObject* j3NegativeArraySizeException(sint32 val);
@@ -84,6 +95,14 @@ namespace force_linker {
       (void) j3StartJNI(0, 0, 0);
       (void) j3JavaObjectAquire(0);
       (void) j3JavaObjectRelease(0);
+      (void) j3ArrayFill(0, 0, 0);
+      (void) j3ArrayEquals(0, 0, 0);
+      (void) j3StringEquals(0, 0);
+      (void) j3StringHashCode(0);
+      (void) j3StringIndexOf(0, 0);
+      (void) j3NanoTime();
+      (void) j3CompileOSR(0, 0);
+      (void) j3IsSecondaryType(0, 0, 0);
       (void) j3ThrowException(0);
       (void) j3NullPointerException();
       (void) j3NegativeArraySizeException(0);
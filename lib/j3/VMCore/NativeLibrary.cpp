@@ -0,0 +1,155 @@
+//===------ NativeLibrary.cpp - Native libraries loaded by Java code ------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstring>
+#include <dlfcn.h>
+
+#if defined(__linux__)
+#include <elf.h>
+#include <link.h>
+#endif
+
+#include "JavaCompiler.h"
+
+#include "NativeLibrary.h"
+
+using namespace j3;
+
+NativeLibrary::NativeLibrary(void* h) {
+  handle = h;
+  symbols = NULL;
+  mask = 0;
+  buildIndex();
+}
+
+NativeLibrary::~NativeLibrary() {
+  delete[] symbols;
+}
+
+uint32 NativeLibrary::hashName(const char* name) {
+  uint32 hash = 2166136261u;
+  for (const char* cur = name; *cur != 0; ++cur) {
+    hash = (hash ^ (uint8)*cur) * 16777619u;
+  }
+  return hash;
+}
+
+void NativeLibrary::insert(const char* name, word_t address) {
+  uint32 hash = hashName(name);
+  uint32 index = hash & mask;
+  while (symbols[index].name != NULL) index = (index + 1) & mask;
+  symbols[index].name = name;
+  symbols[index].address = address;
+  symbols[index].hash = hash;
+}
+
+word_t NativeLibrary::lookup(JavaCompiler* compiler, const char* name) {
+  if (symbols == NULL) return (word_t)compiler->loadMethod(handle, name);
+
+  uint32 hash = hashName(name);
+  for (uint32 index = hash & mask; symbols[index].name != NULL;
+       index = (index + 1) & mask) {
+    if (symbols[index].hash == hash && !strcmp(symbols[index].name, name)) {
+      return symbols[index].address;
+    }
+  }
+  return 0;
+}
+
+word_t NativeLibrary::lookupInDependencies(JavaCompiler* compiler,
+                                           const char* name) {
+  if (symbols == NULL) return 0;
+  return (word_t)compiler->loadMethod(handle, name);
+}
+
+#if defined(__linux__)
+
+bool NativeLibrary::buildIndex() {
+  struct link_map* map = NULL;
+  if (dlinfo(handle, RTLD_DI_LINKMAP, &map) != 0 || map == NULL) return false;
+
+  const ElfW(Sym)* symtab = NULL;
+  const char* strtab = NULL;
+  const uint32* hashtab = NULL;
+  const uint32* gnuHashtab = NULL;
+  for (const ElfW(Dyn)* dyn = map->l_ld; dyn->d_tag != DT_NULL; ++dyn) {
+    // The loader relocates the dynamic section on most architectures. Add
+    // the base address to the entries it has not relocated.
+    word_t ptr = dyn->d_un.d_ptr;
+    if (ptr < map->l_addr) ptr += map->l_addr;
+    switch (dyn->d_tag) {
+      case DT_SYMTAB: symtab = (const ElfW(Sym)*)ptr; break;
+      case DT_STRTAB: strtab = (const char*)ptr; break;
+      case DT_HASH: hashtab = (const uint32*)ptr; break;
+      case DT_GNU_HASH: gnuHashtab = (const uint32*)ptr; break;
+    }
+  }
+  if (symtab == NULL || strtab == NULL) return false;
+
+  // The number of symbols is the number of chains of the hash table. With
+  // only a GNU hash table, it is one past the end of the last chain.
+  uint32 nbSymbols = 0;
+  if (hashtab != NULL) {
+    nbSymbols = hashtab[1];
+  } else if (gnuHashtab != NULL) {
+    uint32 nbBuckets = gnuHashtab[0];
+    uint32 firstSymbol = gnuHashtab[1];
+    uint32 bloomSize = gnuHashtab[2];
+    const uint32* buckets =
+      (const uint32*)((const ElfW(Addr)*)(gnuHashtab + 4) + bloomSize);
+    const uint32* chains = buckets + nbBuckets;
+    uint32 last = 0;
+    for (uint32 i = 0; i < nbBuckets; ++i) {
+      if (buckets[i] > last) last = buckets[i];
+    }
+    if (last < firstSymbol) {
+      nbSymbols = firstSymbol;
+    } else {
+      while ((chains[last - firstSymbol] & 1) == 0) ++last;
+      nbSymbols = last + 1;
+    }
+  } else {
+    return false;
+  }
+
+  uint32 nbFunctions = 0;
+  for (uint32 pass = 0; pass < 2; ++pass) {
+    for (uint32 i = 0; i < nbSymbols; ++i) {
+      const ElfW(Sym)* sym = &symtab[i];
+      if (sym->st_shndx == SHN_UNDEF) continue;
+      if (ELF32_ST_TYPE(sym->st_info) != STT_FUNC) continue;
+      if (ELF32_ST_BIND(sym->st_info) == STB_LOCAL) continue;
+      // Index the JNI functions, and their critical versions.
+      const char* name = strtab + sym->st_name;
+      if (strncmp(name, "Java", 4) != 0) continue;
+      if (pass == 0) {
+        ++nbFunctions;
+      } else {
+        insert(name, map->l_addr + sym->st_value);
+      }
+    }
+
+    if (pass == 0) {
+      uint32 size = 16;
+      while (size < 2 * nbFunctions) size <<= 1;
+      symbols = new Symbol[size];
+      memset(symbols, 0, size * sizeof(Symbol));
+      mask = size - 1;
+    }
+  }
+  return true;
+}
+
+#else
+
+bool NativeLibrary::buildIndex() {
+  return false;
+}
+
+#endif
@@ -0,0 +1,81 @@
+//===------- NativeLibrary.h - Native libraries loaded by Java code -------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef JNJVM_NATIVE_LIBRARY_H
+#define JNJVM_NATIVE_LIBRARY_H
+
+#include "types.h"
+#include "vmkit/System.h"
+
+namespace j3 {
+
+class JavaCompiler;
+
+/// NativeLibrary - A native library loaded by a class loader, or the VM. The
+/// JNI functions of the library are indexed in one pass over its dynamic
+/// symbol table when it is loaded, so that looking up native methods does not
+/// call dlsym for each name. If the symbol table can not be read, lookups
+/// fall back to dlsym.
+///
+class NativeLibrary {
+private:
+  struct Symbol {
+    const char* name;
+    word_t address;
+    uint32 hash;
+  };
+
+  /// symbols - Hash table of the JNI functions, with linear probing. Null if
+  /// the library is not indexed.
+  ///
+  Symbol* symbols;
+
+  /// mask - The size of the table minus one. The size is a power of two.
+  ///
+  uint32 mask;
+
+  static uint32 hashName(const char* name);
+
+  void insert(const char* name, word_t address);
+
+  /// buildIndex - Read the dynamic symbol table of the library. Return false
+  /// if it can not be read.
+  ///
+  bool buildIndex();
+
+public:
+  /// handle - The handle returned by dlopen.
+  ///
+  void* handle;
+
+  NativeLibrary(void* handle);
+  ~NativeLibrary();
+
+  /// isIndexed - Were the JNI functions of the library indexed? If not,
+  /// lookups call dlsym.
+  ///
+  bool isIndexed() const {
+    return symbols != NULL;
+  }
+
+  /// lookup - Get the address of the function with the given name, or 0 if
+  /// the library does not define it.
+  ///
+  word_t lookup(JavaCompiler* compiler, const char* name);
+
+  /// lookupInDependencies - Get the address of the function with the given
+  /// name with dlsym, which also searches the libraries this library depends
+  /// on. Returns 0 if the library is not indexed: lookup already used dlsym.
+  ///
+  word_t lookupInDependencies(JavaCompiler* compiler, const char* name);
+};
+
+}
+
+#endif
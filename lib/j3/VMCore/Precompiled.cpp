@@ -11,6 +11,7 @@
 #include <dlfcn.h> 
 #include "vmkit/MethodInfo.h"
 
+#include "ClassHierarchy.h"
 #include "JavaClass.h"
 #include "JavaUpcalls.h"
 #include "JnjvmClassLoader.h"
@@ -161,6 +162,9 @@ bool Precompiled::Init(JnjvmBootstrapLoader* loader) {
   for (ClassMap::iterator i = loader->getClasses()->map.begin(),
        e = loader->getClasses()->map.end(); i != e; i++) {
     i->second->classLoader = loader;
+    if (i->second->isClass()) {
+      ClassHierarchy::addClass(i->second->asClass());
+    }
   }
  
   // Get the base object arrays after the init, because init puts arrays
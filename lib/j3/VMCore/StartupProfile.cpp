@@ -0,0 +1,168 @@
+//===------ StartupProfile.cpp - Startup recording and replay -------------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+
+#include "JavaAccess.h"
+#include "JavaClass.h"
+#include "JavaThread.h"
+#include "JavaUpcalls.h"
+#include "Jnjvm.h"
+#include "JnjvmClassLoader.h"
+#include "StartupProfile.h"
+
+using namespace j3;
+
+StartupProfile* StartupProfile::recorder = NULL;
+
+static uint64 currentTimeMillis() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (uint64)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+StartupProfile::StartupProfile(Jnjvm* v, FILE* f, uint32 seconds) {
+  vm = v;
+  file = f;
+  deadline = currentTimeMillis() + (uint64)seconds * 1000;
+}
+
+void StartupProfile::startRecording(Jnjvm* vm, char* arg) {
+  uint32 seconds = DefaultSeconds;
+  char* comma = strrchr(arg, ',');
+  if (comma != NULL) {
+    comma[0] = 0;
+    seconds = atoi(&comma[1]);
+  }
+  FILE* file = fopen(arg, "w");
+  if (file == NULL) {
+    fprintf(stderr, "Can't open startup profile %s\n", arg);
+    return;
+  }
+  StartupProfile* profile = new StartupProfile(vm, file, seconds);
+  // Publish the recorder once it is fully constructed.
+  __sync_synchronize();
+  recorder = profile;
+}
+
+char StartupProfile::getLoaderTag(JnjvmClassLoader* loader) {
+  if (loader == (JnjvmClassLoader*)vm->bootstrapLoader) return 'B';
+  if (loader == vm->appClassLoader) return 'A';
+  return 0;
+}
+
+bool StartupProfile::shouldRecord(char event, void* key) {
+  if (file == NULL) return false;
+  if (currentTimeMillis() > deadline) {
+    fclose(file);
+    file = NULL;
+    recorded.clear();
+    // Stop the hooks from calling in. The recorder is not deleted: other
+    // threads may still have read the pointer, and call in with the file
+    // closed.
+    recorder = NULL;
+    __sync_synchronize();
+    return false;
+  }
+  return recorded.insert(std::make_pair(event, key)).second;
+}
+
+void StartupProfile::recordClass(char event, Class* cl) {
+  char tag = getLoaderTag(cl->classLoader);
+  if (!tag) return;
+  lock.lock();
+  if (shouldRecord(event, cl)) {
+    fprintf(file, "%c %c %s\n", event, tag, UTF8Buffer(cl->name).cString());
+  }
+  lock.unlock();
+}
+
+void StartupProfile::recordMethod(JavaMethod* meth) {
+  Class* cl = meth->classDef;
+  char tag = getLoaderTag(cl->classLoader);
+  if (!tag) return;
+  lock.lock();
+  if (shouldRecord(Compile, meth)) {
+    fprintf(file, "%c %c %s %s %s %c\n", Compile, tag,
+            UTF8Buffer(cl->name).cString(),
+            UTF8Buffer(meth->name).cString(),
+            UTF8Buffer(meth->type).cString(),
+            isStatic(meth->access) ? 'S' : 'V');
+  }
+  lock.unlock();
+}
+
+void StartupReplayThread::startReplay(Jnjvm* vm, const char* fileName) {
+  JavaObject* group = NULL;
+  JavaObject* javaThread = NULL;
+  llvm_gcroot(group, 0);
+  llvm_gcroot(javaThread, 0);
+
+  FILE* file = fopen(fileName, "r");
+  if (file == NULL) return;
+  StartupReplayThread* th = new StartupReplayThread(vm, file);
+
+  // Like the finalizer and reference threads, the replay thread belongs to
+  // the system group. It is a daemon: it must not keep the VM alive.
+  group = vm->upcalls->group->getInstanceObjectField(
+      vm->getFinalizerThread()->currentThread());
+  vm->upcalls->CreateJavaThread(vm, th, "Startup Replay", group);
+  javaThread = th->currentThread();
+  vm->upcalls->daemon->setInstanceInt8Field(javaThread, (uint32)true);
+
+  th->start((void (*)(vmkit::Thread*))replayStart);
+}
+
+void StartupReplayThread::replayStart(StartupReplayThread* th) {
+  char line[4096];
+  while (fgets(line, sizeof(line), th->file) != NULL) {
+    TRY {
+      th->replayEvent(line);
+    } IGNORE;
+  }
+  fclose(th->file);
+  th->file = NULL;
+}
+
+void StartupReplayThread::replayEvent(char* line) {
+  char event = 0;
+  char tag = 0;
+  char className[1024];
+  char methName[1024];
+  char methType[1024];
+  char kind = 0;
+  int nb = sscanf(line, "%c %c %1023s %1023s %1023s %c", &event, &tag,
+                  className, methName, methType, &kind);
+  if (nb < 3) return;
+
+  Jnjvm* vm = getJVM();
+  JnjvmClassLoader* loader = NULL;
+  if (tag == 'B') loader = vm->bootstrapLoader;
+  else if (tag == 'A') loader = vm->appClassLoader;
+  if (loader == NULL) return;
+
+  const UTF8* name = loader->asciizConstructUTF8(className);
+  bool doResolve = (event != StartupProfile::Load);
+  UserCommonClass* cl = loader->loadName(name, doResolve, false, NULL);
+  if (cl == NULL || !cl->isClass()) return;
+
+  if (event == StartupProfile::Compile && nb == 6) {
+    Class* cls = cl->asClass();
+    JavaMethod* meth = cls->lookupMethodDontThrow(
+        loader->asciizConstructUTF8(methName),
+        loader->asciizConstructUTF8(methType),
+        kind == 'S', false, NULL);
+    if (meth != NULL && meth->code == NULL && !isNative(meth->access) &&
+        !isAbstract(meth->access)) {
+      meth->compiledPtr(NULL);
+    }
+  }
+}
@@ -0,0 +1,139 @@
+//===------- StartupProfile.h - Startup recording and replay --------------===//
+//
+//                            The VMKit project
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef J3_STARTUP_PROFILE_H
+#define J3_STARTUP_PROFILE_H
+
+#include <cstdio>
+#include <set>
+
+#include "vmkit/Locks.h"
+
+#include "JavaThread.h"
+
+namespace j3 {
+
+class Class;
+class JavaMethod;
+class Jnjvm;
+class JnjvmClassLoader;
+
+/// StartupProfile - Records, in order, the classes loaded, resolved and
+/// initialized and the methods compiled during the first seconds of an
+/// execution. The profile is a text file with one event per line:
+///
+///   <event> <loader> <class> [<method> <signature> <S|V>]
+///
+/// where event is one of L (load), R (resolve), I (initialise) or C
+/// (compile) and loader is B for the bootstrap loader or A for the
+/// application loader. Classes defined by other loaders are not recorded.
+///
+class StartupProfile {
+public:
+
+  /// Event kinds, as written in the profile.
+  ///
+  static const char Load = 'L';
+  static const char Resolve = 'R';
+  static const char Initialise = 'I';
+  static const char Compile = 'C';
+
+  /// DefaultSeconds - Length of the recording window when none is given.
+  ///
+  static const uint32 DefaultSeconds = 10;
+
+  /// recorder - The active recorder, or null if the VM does not record its
+  /// startup or if the window has expired. Hooks test this before calling
+  /// into the recorder.
+  ///
+  static StartupProfile* recorder;
+
+  /// StartupProfile - Start recording into the given file for the given
+  /// number of seconds.
+  ///
+  StartupProfile(Jnjvm* vm, FILE* file, uint32 seconds);
+
+  /// startRecording - Parse the argument of -Xrecord-startup:<file>[,<secs>]
+  /// and install the recorder.
+  ///
+  static void startRecording(Jnjvm* vm, char* arg);
+
+  /// recordClass - Record a load, resolve or initialise event.
+  ///
+  void recordClass(char event, Class* cl);
+
+  /// recordMethod - Record the compilation of a method.
+  ///
+  void recordMethod(JavaMethod* meth);
+
+private:
+
+  /// vm - The virtual machine being recorded.
+  ///
+  Jnjvm* vm;
+
+  /// file - The output profile, closed when the window expires.
+  ///
+  FILE* file;
+
+  /// deadline - End of the recording window, in milliseconds.
+  ///
+  uint64 deadline;
+
+  /// lock - Protects the file and the set of recorded events.
+  ///
+  vmkit::LockNormal lock;
+
+  /// recorded - Events already written, so that repeated loads of the same
+  /// class are only recorded once.
+  ///
+  std::set< std::pair<char, void*> > recorded;
+
+  /// getLoaderTag - Get the tag of the given loader, or 0 if the loader is
+  /// not recorded.
+  ///
+  char getLoaderTag(JnjvmClassLoader* loader);
+
+  /// shouldRecord - Check the window and the event set. Called with the
+  /// lock held.
+  ///
+  bool shouldRecord(char event, void* key);
+};
+
+/// StartupReplayThread - A daemon thread that reads a startup profile and
+/// loads, resolves and compiles its content ahead of the application.
+/// Class initialisation is never replayed: static initializers must run in
+/// program order, on the thread that triggers them.
+///
+class StartupReplayThread : public JavaThread {
+public:
+
+  /// file - The profile being replayed.
+  ///
+  FILE* file;
+
+  StartupReplayThread(Jnjvm* vm, FILE* f) : JavaThread(vm), file(f) {}
+
+  /// startReplay - Open the profile of -Xreplay-startup:<file> and start a
+  /// replay thread if it exists.
+  ///
+  static void startReplay(Jnjvm* vm, const char* fileName);
+
+  /// replayStart - The entry point of the thread.
+  ///
+  static void replayStart(StartupReplayThread* th);
+
+  /// replayEvent - Replay one line of the profile.
+  ///
+  void replayEvent(char* line);
+};
+
+} // end namespace j3
+
+#endif
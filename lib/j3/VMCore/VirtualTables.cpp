@@ -275,13 +275,15 @@ void Jnjvm::tracer(word_t closure) {
   }
   
   // (3) Trace JNI global references.
-  JNIGlobalReferences* start = &globalRefs;
-  while (start != NULL) {
-    for (uint32 i = 0; i < start->length; ++i) {
-      JavaObject** obj = start->globalReferences + i;
-      vmkit::Collector::markAndTraceRoot(obj, closure);
+  JNIGlobalReferences::Slab* slab = globalRefs.slabs;
+  while (slab != NULL) {
+    for (uint32 i = 0; i < JNIGlobalReferences::SlabSize; ++i) {
+      JavaObject** obj = slab->globalReferences + i;
+      if (!JNIGlobalReferences::isFree(*obj)) {
+        vmkit::Collector::markAndTraceRoot(obj, closure);
+      }
     }
-    start = start->next;
+    slab = slab->next;
   }
   
   // (4) Trace the finalization queue.
@@ -312,6 +314,13 @@ void Jnjvm::tracer(word_t closure) {
   for (i = i + 1; i < vmkit::LockSystem::GlobalSize; i++) {
     assert(lockSystem.LockTable[i] == NULL);
   }
+
+  // (7) Trace the shared exceptions of hot throw sites.
+  for (i = 0; i < NumFastThrowKinds; i++) {
+    if (fastThrowExceptions[i] != NULL) {
+      vmkit::Collector::markAndTraceRoot(fastThrowExceptions + i, closure);
+    }
+  }
 }
 
 void JavaThread::tracer(word_t closure) {
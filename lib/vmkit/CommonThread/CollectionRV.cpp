@@ -46,6 +46,63 @@ void CollectionRV::waitRV() {
   } 
 }
 
+void CollectionRV::enterCritical() {
+  vmkit::Thread* th = vmkit::Thread::get();
+  assert((th->getLastSP() == 0) && "SP present in cooperative code");
+
+  lockRV();
+  // A collection has started and waits for this thread: join it, as it may
+  // move the objects. No other collection starts once the lock is released,
+  // since the section is entered.
+  if (initiator != NULL) {
+    th->inRV = true;
+    th->setLastSP(System::GetCallerAddress());
+    if (!th->joinedRV) {
+      th->joinedRV = true;
+      another_mark();
+    }
+    waitEndOfRV();
+    th->setLastSP(0);
+    th->inRV = false;
+  }
+  nbCritical++;
+  unlockRV();
+}
+
+void CollectionRV::exitCritical() {
+  lockRV();
+  assert(nbCritical > 0 && "Exiting a critical section not entered");
+  nbCritical--;
+  if (nbCritical == 0) condCritical.broadcast();
+  unlockRV();
+}
+
+bool CollectionRV::waitCriticalSections() {
+  vmkit::Thread* th = vmkit::Thread::get();
+  if (nbCritical == 0) return true;
+
+  // The thread blocks: let the rendezvous of other threads go on without
+  // it, and join them if they are still going on when it wakes up. A
+  // rendezvous that is not a collection frees no memory: keep waiting for
+  // the critical sections after it.
+  th->setLastSP(System::GetCallerAddress());
+  bool joinedCollection = false;
+  while (nbCritical != 0 && !joinedCollection) {
+    if (initiator != NULL) {
+      joinedCollection = collecting;
+      if (!th->joinedRV) {
+        th->joinedRV = true;
+        another_mark();
+      }
+      waitEndOfRV();
+    } else {
+      condCritical.wait(&_lockRV);
+    }
+  }
+  th->setLastSP(0);
+  return !joinedCollection;
+}
+
 void CooperativeCollectionRV::synchronize() {
   assert(nbJoined == 0);
   vmkit::Thread* self = vmkit::Thread::get();
@@ -165,6 +222,7 @@ void CooperativeCollectionRV::finishRV() {
   initiator->MyVM->threadLock.unlock();
   condEndRV.broadcast();
   initiator = NULL;
+  collecting = false;
   unlockRV();
   vmkit::Thread::get()->inRV = false;
 }
@@ -22,6 +22,60 @@
 
 namespace vmkit {
 
+bool ThinLock::supportsBiasing() {
+  return BiasedMask != 0 && !Collector::needsWriteBarrier();
+}
+
+bool ThinLock::biasedToOtherThread(word_t header) {
+  return (header & BiasedMask) &&
+    ((header & ThreadIDMask) != vmkit::Thread::get()->getThreadID());
+}
+
+/// unbiasedHeader - The thin lock header equivalent to a biased header. The
+/// owner keeps the lock if it holds it.
+static word_t unbiasedHeader(word_t header) {
+  word_t count = (header & ThinLock::ThinCountMask) >> ThinLock::ThinCountShift;
+  word_t result = (header & ThinLock::NonLockBitsMask) | ThinLock::UnbiasableMask;
+  if (count != 0) {
+    result |= (header & ThinLock::ThreadIDMask) |
+      ((count - 1) << ThinLock::ThinCountShift);
+  }
+  return result;
+}
+
+void ThinLock::revokeBias(gc* object) {
+  llvm_gcroot(object, 0);
+  vmkit::Thread* th = vmkit::Thread::get();
+  word_t header = object->header;
+  if (!(header & BiasedMask)) return;
+
+  if ((header & ThreadIDMask) == th->getThreadID()) {
+    // Other threads do not write a biased header while we run.
+    object->header = unbiasedHeader(header);
+    return;
+  }
+
+  // Stop the owner of the bias, which updates the header without atomic
+  // operations, before rewriting it.
+  bool revoked = false;
+  while (object->header & BiasedMask) {
+    th->MyVM->rendezvous.startRV();
+    if (th->MyVM->rendezvous.getInitiator() != NULL) {
+      th->MyVM->rendezvous.cancelRV();
+      th->MyVM->rendezvous.join();
+    } else {
+      th->MyVM->rendezvous.synchronize();
+      header = object->header;
+      if (header & BiasedMask) {
+        object->header = unbiasedHeader(header);
+        revoked = true;
+      }
+      th->MyVM->rendezvous.finishRV();
+    }
+  }
+  if (revoked) th->MyVM->biasRevoked(object);
+}
+
 void ThinLock::overflowThinLock(gc* object, LockSystem& table) {
   llvm_gcroot(object, 0);
   FatLock* obj = table.allocate(object);
@@ -64,6 +118,7 @@ void ThinLock::removeFatLock(FatLock* fatLock, LockSystem& table) {
   
 FatLock* ThinLock::changeToFatlock(gc* object, LockSystem& table) {
   llvm_gcroot(object, 0);
+  revokeBias(object);
   if (!(object->header & FatMask)) {
     FatLock* obj = table.allocate(object);
     uint32 count = (object->header & ThinCountMask) >> ThinCountShift;
@@ -113,7 +168,27 @@ void ThinLock::acquire(gc* object, LockSystem& table) {
   word_t newValue = 0;
   word_t yieldedValue = 0;
 
-  if ((object->header & System::GetThreadIDMask()) == id) {
+  oldValue = object->header;
+  if (oldValue & BiasedMask) {
+    if (((oldValue & ThreadIDMask) == id) &&
+        ((oldValue & ThinCountMask) != ThinCountMask)) {
+      // We own the bias: nobody else writes the header.
+      object->header = oldValue + ThinCountAdd;
+      assert(owner(object, table) && "Not owner after quitting acquire!");
+      return;
+    }
+    revokeBias(object);
+  } else if (((oldValue & ~NonLockBitsMask) == 0) &&
+             !(oldValue & UnbiasableMask) && supportsBiasing()) {
+    newValue = oldValue | id | BiasedMask | ThinCountAdd;
+    yieldedValue = __sync_val_compare_and_swap(&(object->header), oldValue, newValue);
+    if (yieldedValue == oldValue) {
+      assert(owner(object, table) && "Not owner after quitting acquire!");
+      return;
+    }
+  }
+
+  if ((object->header & ThreadIDMask) == id) {
     assert(owner(object, table) && "Inconsistent lock");
     if ((object->header & ThinCountMask) != ThinCountMask) {
       uint32 count = object->header & ThinCountMask;
@@ -161,6 +236,8 @@ void ThinLock::acquire(gc* object, LockSystem& table) {
     while (object->header & ~NonLockBitsMask) {
       if (object->header & FatMask) {
         break;
+      } else if (object->header & BiasedMask) {
+        revokeBias(object);
       } else {
         vmkit::Thread::yield();
       }
@@ -199,7 +276,17 @@ void ThinLock::release(gc* object, LockSystem& table) {
   word_t oldValue = 0;
   word_t newValue = 0;
   word_t yieldedValue = 0;
-  if ((object->header & ~NonLockBitsMask) == id) {
+  if (object->header & BiasedMask) {
+    // Only the bias owner writes the header, and only while it holds the
+    // lock.
+    oldValue = object->header;
+    if (((oldValue & ThreadIDMask) != id) ||
+        ((oldValue & ThinCountMask) == 0)) {
+      assert(0 && "Releasing a biased lock not held");
+      return;
+    }
+    object->header = oldValue - ThinCountAdd;
+  } else if ((object->header & ~NonLockBitsMask) == id) {
     do {
       oldValue = object->header;
       newValue = oldValue & NonLockBitsMask;
@@ -229,7 +316,10 @@ bool ThinLock::owner(gc* object, LockSystem& table) {
     if (obj != NULL) return obj->owner();
   } else {
     uint64 id = vmkit::Thread::get()->getThreadID();
-    if ((object->header & System::GetThreadIDMask()) == id) return true;
+    if ((object->header & ThreadIDMask) == id) {
+      return !(object->header & BiasedMask) ||
+        ((object->header & ThinCountMask) != 0);
+    }
   }
   return false;
 }
@@ -376,7 +466,8 @@ FatLock* LockSystem::allocate(gc* obj) {
 
 FatLock* LockSystem::getFatLockFromID(word_t ID) {
   if (ID & ThinLock::FatMask) {
-    uint32_t index = (ID & ~ThinLock::FatMask) >> ThinLock::NonLockBits;
+    uint32_t index =
+      (ID & ~(ThinLock::FatMask | ThinLock::NonLockBitsMask)) >> ThinLock::NonLockBits;
     FatLock* res = getLock(index);
     return res;
   } else {
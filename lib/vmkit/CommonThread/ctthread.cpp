@@ -250,6 +250,7 @@ word_t Thread::baseAddr = 0;
 // These could be set at runtime.
 #define STACK_SIZE 0x100000
 #define NR_THREADS 255
+#define NR_CACHED_THREADS 32
 
 /// StackThreadManager - This class allocates all stacks for threads. Because
 /// we want fast access to thread local data, and can not rely on platform
@@ -262,12 +263,48 @@ word_t Thread::baseAddr = 0;
 /// 0x?0000000 and Ox(?+1)0000000, so that the thread local data can be computed
 /// and threads have a unique ID.
 ///
+/// The manager also caches exited threads: instead of exiting, the system
+/// thread of a cached stack waits until a new thread is started on the
+/// stack. Its alternative stack and signal handlers are then already set up.
+///
 class StackThreadManager {
 public:
+  /// SlotState - The state of the system thread running on a stack.
+  ///
+  enum SlotState {
+    Running,  // Running a thread, or exiting.
+    Parking,  // Exiting and going to wait for a new thread.
+    Cached,   // Waiting for a new thread.
+    Resumed   // Given a new thread to run.
+  };
+
   word_t baseAddr;
-  uint32 allocPtr;
-  uint32 used[NR_THREADS];
-  LockNormal stackLock;
+
+  /// freeIndexes - The indexes of the stacks not in use, the next stack to
+  /// use at the end.
+  ///
+  uint32 freeIndexes[NR_THREADS];
+  uint32 nbFree;
+
+  /// cachedIndexes - The indexes of the cached stacks, the next stack to use
+  /// at the end.
+  ///
+  uint32 cachedIndexes[NR_CACHED_THREADS];
+  uint32 nbCached;
+
+  /// nbParked - The number of stacks parking or cached.
+  ///
+  uint32 nbParked;
+
+  SlotState states[NR_THREADS];
+  pthread_t threadIDs[NR_THREADS];
+  pthread_cond_t resumeVars[NR_THREADS];
+
+  /// stackLock - Protects the manager. Exited threads are not known by
+  /// their virtual machine any more and can not take VMKit locks, so this is
+  /// a system lock. It is never held for long.
+  ///
+  pthread_mutex_t stackLock;
 
   StackThreadManager() {
     baseAddr = 0;
@@ -290,23 +327,38 @@ public:
       mprotect((void*)addr, pagesize, PROT_NONE);
     }
 
-    memset((void*)used, 0, NR_THREADS * sizeof(uint32));
-    allocPtr = 0;
+    // Use the stacks in order of their index.
+    for (uint32 i = 0; i < NR_THREADS; ++i) {
+      freeIndexes[i] = NR_THREADS - 1 - i;
+      states[i] = Running;
+      pthread_cond_init(&resumeVars[i], NULL);
+    }
+    nbFree = NR_THREADS;
+    nbCached = 0;
+    nbParked = 0;
+    pthread_mutex_init(&stackLock, NULL);
     vmkit::Thread::baseAddr = baseAddr;
   }
 
+  /// getIndex - Get the index of the stack of the thread.
+  ///
+  uint32 getIndex(vmkit::Thread* th) {
+    word_t index = ((word_t)th & System::GetThreadIDMask());
+    return (index & ~baseAddr) >> 20;
+  }
+
+  /// allocate - Get a stack, preferably a cached one.
+  ///
   word_t allocate() {
-    stackLock.lock();
-    uint32 myIndex = 0;
-    do {
-      if (!used[myIndex]) {
-        used[myIndex] = 1;
-        break;
-      }
-      ++myIndex;
-    } while (myIndex != NR_THREADS);
-  
-    stackLock.unlock();
+    uint32 myIndex = NR_THREADS;
+    pthread_mutex_lock(&stackLock);
+    if (nbCached != 0) {
+      myIndex = cachedIndexes[--nbCached];
+      --nbParked;
+    } else if (nbFree != 0) {
+      myIndex = freeIndexes[--nbFree];
+    }
+    pthread_mutex_unlock(&stackLock);
     
     if (myIndex != NR_THREADS)
       return baseAddr + myIndex * STACK_SIZE;
@@ -314,6 +366,66 @@ public:
     return 0;
   }
 
+  /// release - Give back the stack of a thread whose system thread exited.
+  ///
+  void release(uint32 index) {
+    pthread_mutex_lock(&stackLock);
+    freeIndexes[nbFree++] = index;
+    pthread_mutex_unlock(&stackLock);
+  }
+
+  /// reserveCache - Called by an exiting thread before leaving its virtual
+  /// machine. Return whether the thread will wait for a new thread instead
+  /// of exiting.
+  ///
+  bool reserveCache(uint32 index) {
+    bool res = false;
+    pthread_mutex_lock(&stackLock);
+    if (nbParked < NR_CACHED_THREADS) {
+      ++nbParked;
+      states[index] = Parking;
+      threadIDs[index] = pthread_self();
+      res = true;
+    }
+    pthread_mutex_unlock(&stackLock);
+    return res;
+  }
+
+  /// cache - Make the stack of a parking thread available for a new thread.
+  /// Return false if the thread is exiting.
+  ///
+  bool cache(uint32 index) {
+    bool res = false;
+    pthread_mutex_lock(&stackLock);
+    if (states[index] == Parking) {
+      states[index] = Cached;
+      cachedIndexes[nbCached++] = index;
+      res = true;
+    }
+    pthread_mutex_unlock(&stackLock);
+    return res;
+  }
+
+  /// resume - Run the new thread of a cached stack.
+  ///
+  void resume(uint32 index) {
+    pthread_mutex_lock(&stackLock);
+    assert(states[index] == Cached && "Resuming a thread not cached");
+    states[index] = Resumed;
+    pthread_cond_signal(&resumeVars[index]);
+    pthread_mutex_unlock(&stackLock);
+  }
+
+  /// park - Wait until a new thread is started on the stack.
+  ///
+  void park(uint32 index) {
+    pthread_mutex_lock(&stackLock);
+    while (states[index] != Resumed) {
+      pthread_cond_wait(&resumeVars[index], &stackLock);
+    }
+    states[index] = Running;
+    pthread_mutex_unlock(&stackLock);
+  }
 };
 
 
@@ -325,11 +437,10 @@ extern void sigsegvHandler(int, siginfo_t*, void*);
 
 /// internalThreadStart - The initial function called by a thread. Sets some
 /// thread specific data, registers the thread to the GC and calls the
-/// given routine of th.
+/// given routine of th. When the routine returns, the system thread may
+/// wait in the stack manager and run the next thread started on its stack.
 ///
 void Thread::internalThreadStart(vmkit::Thread* th) {
-  th->baseSP  = System::GetCallerAddress();
-
   // Set the alternate stack as the second page of the thread's
   // stack.
   stack_t st;
@@ -348,20 +459,40 @@ void Thread::internalThreadStart(vmkit::Thread* th) {
   sigaction(SIGSEGV, &sa, NULL);
   sigaction(SIGBUS, &sa, NULL);
 
-  assert(th->MyVM && "VM not set in a thread");
-  th->MyVM->rendezvous.addThread(th);
-  th->routine(th);
-  th->MyVM->removeThread(th);
+  uint32 index = TheStackManager.getIndex(th);
+  while (true) {
+    th->baseSP  = System::GetCallerAddress();
+    assert(th->MyVM && "VM not set in a thread");
+    th->MyVM->rendezvous.addThread(th);
+    th->routine(th);
+
+    bool cached = TheStackManager.reserveCache(index);
+    th->MyVM->removeThread(th);
+    if (!cached) return;
+
+    // The Thread object may be reused as soon as the thread is removed: do
+    // not use it until a new thread is started.
+    TheStackManager.park(index);
+  }
 }
 
 
 
 /// start - Called by the creator of the thread to run the new thread.
 int Thread::start(void (*fct)(vmkit::Thread*)) {
+  routine = fct;
+  uint32 index = TheStackManager.getIndex(this);
+  if (TheStackManager.states[index] == StackThreadManager::Cached) {
+    // The system thread of the stack waits for this thread.
+    internalThreadID = (void*)TheStackManager.threadIDs[index];
+    MyVM->addThread(this);
+    TheStackManager.resume(index);
+    return 0;
+  }
+
   pthread_attr_t attributs;
   pthread_attr_init(&attributs);
   pthread_attr_setstack(&attributs, this, STACK_SIZE);
-  routine = fct;
   // Make sure to add it in the list of threads before leaving this function:
   // the garbage collector wants to trace this thread.
   MyVM->addThread(this);
@@ -378,14 +509,18 @@ int Thread::start(void (*fct)(vmkit::Thread*)) {
 void* Thread::operator new(size_t sz) {
   assert(sz < (size_t)getpagesize() && "Thread local data too big");
   void* res = (void*)TheStackManager.allocate();
-  // Make sure the thread information is cleared.
+  // Make sure the thread information is cleared. The system thread of a
+  // cached stack runs at the top of the stack and does not use it.
   if (res != NULL) memset(res, 0, sz);
   return res;
 }
 
 /// releaseThread - Remove the stack of the thread from the list of stacks
-/// in use.
+/// in use, or cache it if its system thread waits for a new thread.
 void Thread::releaseThread(vmkit::Thread* th) {
+  uint32 index = TheStackManager.getIndex(th);
+  if (TheStackManager.cache(index)) return;
+
   // It seems like the pthread implementation in Linux is clearing with NULL
   // the stack of the thread. So we have to get the thread id before
   // calling pthread_join.
@@ -394,7 +529,5 @@ void Thread::releaseThread(vmkit::Thread* th) {
     // Wait for the thread to die.
     pthread_join((pthread_t)thread_id, NULL);
   }
-  word_t index = ((word_t)th & System::GetThreadIDMask());
-  index = (index & ~TheStackManager.baseAddr) >> 20;
-  TheStackManager.used[index] = 0;
+  TheStackManager.release(index);
 }
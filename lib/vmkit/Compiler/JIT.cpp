@@ -240,6 +240,10 @@ void VmkitModule::addCommandLinePasses(FunctionPassManager* PM) {
   PM->doInitialization();
 }
 
+bool VmkitModule::isOptimizing() {
+  return !DisableOptimizations;
+}
+
 LockRecursive VmkitModule::protectEngine;
 
 // We protect the creation of IR with the protectEngine. Note that
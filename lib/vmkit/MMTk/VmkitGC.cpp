@@ -11,6 +11,7 @@
 #include "MutatorThread.h"
 #include "vmkit/VirtualMachine.h"
 
+#include <cstring>
 #include <set>
 
 using namespace vmkit;
@@ -139,6 +140,10 @@ bool Collector::objectReferenceTryCASBarrier(gc*ref, gc** slot, gc* old, gc* val
   return (old == res);
 }
 
+void Collector::objectReferenceBulkCopyBarrier(gc* src, gc** srcSlot, gc* dst, gc** dstSlot, uint32_t count) {
+  memmove(dstSlot, srcSlot, count * sizeof(gc*));
+}
+
 void Collector::collect() {
   // Do nothing.
 }
@@ -153,3 +158,7 @@ bool Collector::needsWriteBarrier() {
 bool Collector::needsNonHeapWriteBarrier() {
   return false;
 }
+
+bool Collector::willNeverMove(gc* object) {
+  return true;
+}
@@ -93,8 +93,10 @@ public:
   static void objectReferenceArrayWriteBarrier(gc* ref, gc** slot, gc* value) __attribute__ ((always_inline));
   static void objectReferenceNonHeapWriteBarrier(gc** slot, gc* value) __attribute__ ((always_inline));
   static bool objectReferenceTryCASBarrier(gc* ref, gc** slot, gc* old, gc* value) __attribute__ ((always_inline));
+  static void objectReferenceBulkCopyBarrier(gc* src, gc** srcSlot, gc* dst, gc** dstSlot, uint32_t count) __attribute__ ((always_inline));
   static bool needsWriteBarrier() __attribute__ ((always_inline));
   static bool needsNonHeapWriteBarrier() __attribute__ ((always_inline));
+  static bool willNeverMove(gc* object) __attribute__ ((always_inline));
 
   static void collect();
   
@@ -15,6 +15,7 @@
 #include "vmkit/VirtualMachine.h"
 #include "VmkitGC.h"
 
+#include <algorithm>
 #include <dlfcn.h>
 
 namespace vmkit {
@@ -42,27 +43,25 @@ void MethodInfoHelper::print(word_t ip, word_t addr) {
 }
 
 
+static bool compareReturnAddress(FrameInfo* a, FrameInfo* b) {
+  return a->ReturnAddress < b->ReturnAddress;
+}
+
 FunctionMap::FunctionMap(BumpPtrAllocator& allocator, CompiledFrames** allFrames) {
+  AOTFrames = allFrames;
   if (allFrames == NULL) return;
-  Functions.resize(32000); // Make sure the cache is big enough.
+  // The lookups search the index of the frametables. The printer emits it
+  // sorted, but a mis-sorted index would silently lose GC roots: check it
+  // once, and sort it in place if needed. The index is in the data section.
   int i = 0;
   CompiledFrames* compiledFrames = NULL;
   while ((compiledFrames = allFrames[i++]) != NULL) {
-    Frames* currentFrames = compiledFrames->frames();
-    for (uint32_t j = 0; j < compiledFrames->NumCompiledFrames; j++) {
-      FrameIterator iterator(*currentFrames);
-      FrameInfo* frame = NULL;
-      while (iterator.hasNext()) {
-        frame = iterator.next();
-        assert(frame->ReturnAddress);
-        addFrameInfoNoLock(frame->ReturnAddress, frame);
-      }
-      if (frame != NULL) {
-        currentFrames = reinterpret_cast<Frames*>(
-            reinterpret_cast<word_t>(frame) + MethodInfoHelper::FrameInfoSize(frame->NumLiveOffsets));
-      } else {
-        currentFrames = reinterpret_cast<Frames*>(System::WordAlignUp(
-            reinterpret_cast<word_t>(currentFrames) + sizeof(Frames)));
+    FrameInfo** begin = compiledFrames->FrameInfos;
+    FrameInfo** end = begin + compiledFrames->NumFrameInfos;
+    for (uint32_t j = 1; j < compiledFrames->NumFrameInfos; j++) {
+      if (begin[j - 1]->ReturnAddress > begin[j]->ReturnAddress) {
+        std::sort(begin, end, compareReturnAddress);
+        break;
       }
     }
   }
@@ -72,6 +71,16 @@ FunctionMap::FunctionMap(BumpPtrAllocator& allocator, CompiledFrames** allFrames
 static FrameInfo emptyInfo;
 
 FrameInfo* FunctionMap::IPToFrameInfo(word_t ip) {
+  // AOT frametables are read-only, look them up without the lock.
+  if (AOTFrames != NULL) {
+    int i = 0;
+    CompiledFrames* compiledFrames = NULL;
+    while ((compiledFrames = AOTFrames[i++]) != NULL) {
+      FrameInfo* res = compiledFrames->lookup(ip);
+      if (res != NULL) return res;
+    }
+  }
+
   FunctionMapLock.acquire();
   llvm::DenseMap<word_t, FrameInfo*>::iterator I = Functions.find(ip);
   FrameInfo* res = NULL;
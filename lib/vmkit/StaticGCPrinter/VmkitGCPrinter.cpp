@@ -28,6 +28,7 @@
 #include "llvm/Target/TargetLoweringObjectFile.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/SmallVector.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FormattedStream.h"
@@ -273,17 +274,27 @@ Constant* FindMetadata(const Function& F) {
 /// emitAssembly - Print the frametable. The ocaml frametable format is thus:
 ///
 ///   extern "C" struct align(sizeof(word_t)) {
-///     uint32_t NumDescriptors;
+///     uint32_t NumFunctions;
+///     uint32_t NumFrameInfos;
+///     FrameInfo** FrameInfos;
 ///     struct align(sizeof(word_t)) {
-///       void *ReturnAddress;
-///       void *Metadata;
-///       uint16_t BytecodeIndex; 
-///       uint16_t FrameSize;
-///       uint16_t NumLiveOffsets;
-///       uint16_t LiveOffsets[NumLiveOffsets];
-///     } Descriptors[NumDescriptors];
+///       uint32_t NumDescriptors;
+///       struct align(sizeof(word_t)) {
+///         void *Metadata;
+///         void *ReturnAddress;
+///         uint16_t BytecodeIndex; 
+///         uint16_t FrameSize;
+///         uint16_t NumLiveOffsets;
+///         uint16_t LiveOffsets[NumLiveOffsets];
+///       } Descriptors[NumDescriptors];
+///     } Functions[NumFunctions];
 ///   } vmkit${module}__frametable;
 ///
+/// FrameInfos points to an array of NumFrameInfos pointers to the
+/// descriptors, emitted after the table. Functions of the module are emitted
+/// in order in the text section, so the array is sorted by return address
+/// and the runtime can search it in place.
+///
 /// Note that this precludes programs from stack frames larger than 64K
 /// (FrameSize and LiveOffsets would overflow). FrameTablePrinter will abort if
 /// either condition is detected in a function which uses the GC.
@@ -296,10 +307,21 @@ void VmkitAOTGCMetadataPrinter::finishAssembly(AsmPrinter &AP) {
   AP.EmitAlignment(IntPtrSize == 4 ? 2 : 3);
   EmitVmkitGlobal(getModule(), AP, "frametable");
   int NumMethodFrames = 0;
+  int NumFrameInfos = 0;
   for (iterator I = begin(), IE = end(); I != IE; ++I) {
     NumMethodFrames++;
+    GCFunctionInfo &FI = **I;
+    for (GCFunctionInfo::iterator J = FI.begin(), JE = FI.end(); J != JE; ++J) {
+      NumFrameInfos++;
+    }
   }
+  MCSymbol* IndexSym = AP.OutContext.CreateTempSymbol();
+  SmallVector<MCSymbol*, 256> FrameInfoSyms;
   AP.EmitInt32(NumMethodFrames);
+  AP.EmitInt32(NumFrameInfos);
+  AP.OutStreamer.EmitValue(
+      MCSymbolRefExpr::Create(IndexSym, AP.OutStreamer.getContext()),
+      IntPtrSize, 0);
   AP.EmitAlignment(IntPtrSize == 4 ? 2 : 3);
 
   for (iterator I = begin(), IE = end(); I != IE; ++I) {
@@ -343,6 +365,10 @@ void VmkitAOTGCMetadataPrinter::finishAssembly(AsmPrinter &AP) {
       DebugLoc DL = J->Loc;
       uint32_t sourceIndex = DL.getLine();
 
+      MCSymbol* FrameInfoSym = AP.OutContext.CreateTempSymbol();
+      AP.OutStreamer.EmitLabel(FrameInfoSym);
+      FrameInfoSyms.push_back(FrameInfoSym);
+
       // Metadata
       if (Metadata != NULL) {
         AP.EmitGlobalConstant(Metadata);
@@ -379,4 +405,11 @@ void VmkitAOTGCMetadataPrinter::finishAssembly(AsmPrinter &AP) {
       AP.EmitAlignment(IntPtrSize == 4 ? 2 : 3);
     }
   }
+
+  AP.OutStreamer.EmitLabel(IndexSym);
+  for (unsigned i = 0, e = FrameInfoSyms.size(); i != e; ++i) {
+    AP.OutStreamer.EmitValue(
+        MCSymbolRefExpr::Create(FrameInfoSyms[i], AP.OutStreamer.getContext()),
+        IntPtrSize, 0);
+  }
 }
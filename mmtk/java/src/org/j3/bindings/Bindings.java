@@ -25,6 +25,7 @@ import org.vmmagic.pragma.Inline;
 import org.vmmagic.unboxed.Address;
 import org.vmmagic.unboxed.Extent;
 import org.vmmagic.unboxed.ObjectReference;
+import org.vmmagic.unboxed.Offset;
 
 import org.vmutil.options.AddressOption;
 import org.vmutil.options.BooleanOption;
@@ -174,6 +175,39 @@ public final class Bindings {
     }
   }
 
+  @Inline
+  private static boolean bulkCopyWriteBarrier(ObjectReference src, Offset srcOffset, ObjectReference dst, Offset dstOffset, int bytes) {
+    if (Selected.Constraints.get().needsObjectReferenceWriteBarrier()) {
+      Selected.Mutator mutator = Selected.Mutator.get();
+      if (Selected.Constraints.get().objectReferenceBulkCopySupported()) {
+        return mutator.objectReferenceBulkCopy(src, srcOffset, dst, dstOffset, bytes);
+      }
+      // The plan has no bulk barrier: copy the elements one by one through
+      // the element barrier, backwards if the ranges overlap that way.
+      Address srcSlot = src.toAddress().plus(srcOffset);
+      Address dstSlot = dst.toAddress().plus(dstOffset);
+      int count = bytes >> Constants.LOG_BYTES_IN_ADDRESS;
+      if (dstSlot.GT(srcSlot)) {
+        for (int i = count - 1; i >= 0; i--) {
+          Offset offset = Offset.fromIntSignExtend(i << Constants.LOG_BYTES_IN_ADDRESS);
+          Address slot = dstSlot.plus(offset);
+          ObjectReference value = srcSlot.plus(offset).loadObjectReference();
+          mutator.objectReferenceWrite(dst, slot, value, slot.toWord(), slot.toWord(), Constants.ARRAY_ELEMENT);
+        }
+      } else {
+        for (int i = 0; i < count; i++) {
+          Offset offset = Offset.fromIntSignExtend(i << Constants.LOG_BYTES_IN_ADDRESS);
+          Address slot = dstSlot.plus(offset);
+          ObjectReference value = srcSlot.plus(offset).loadObjectReference();
+          mutator.objectReferenceWrite(dst, slot, value, slot.toWord(), slot.toWord(), Constants.ARRAY_ELEMENT);
+        }
+      }
+      return true;
+    } else {
+      return false;
+    }
+  }
+
   @Inline
   private static boolean needsWriteBarrier() {
     return Selected.Constraints.get().needsObjectReferenceWriteBarrier();
@@ -184,6 +218,11 @@ public final class Bindings {
     return Selected.Constraints.get().needsObjectReferenceNonHeapWriteBarrier();
   }
 
+  @Inline
+  private static boolean willNeverMove(ObjectReference object) {
+    return Selected.Plan.get().willNeverMove(object);
+  }
+
   @Inline
   private static void collect(int why) {
     boolean userTriggered = why == Collection.EXTERNAL_GC_TRIGGER;
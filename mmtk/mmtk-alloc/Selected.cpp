@@ -14,6 +14,7 @@
 #include "vmkit/VirtualMachine.h"
 
 #include <sys/mman.h>
+#include <cstring>
 #include <set>
 
 #include "debug.h"
@@ -55,6 +56,8 @@ extern "C" void JnJVM_org_j3_bindings_Bindings_fieldWriteBarrier__Lorg_vmmagic_u
   
 extern "C" void JnJVM_org_j3_bindings_Bindings_nonHeapWriteBarrier__Lorg_vmmagic_unboxed_Address_2Lorg_vmmagic_unboxed_ObjectReference_2(gc** ptr, gc* value) ALWAYS_INLINE;
 
+extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_bulkCopyWriteBarrier__Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Offset_2Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Offset_2I(gc* src, word_t srcOffset, gc* dst, word_t dstOffset, int bytes) ALWAYS_INLINE;
+
 extern "C" void* JnJVM_org_j3_bindings_Bindings_gcmalloc__ILorg_vmmagic_unboxed_ObjectReference_2(
     int sz, void* VT) ALWAYS_INLINE;
 
@@ -226,6 +229,18 @@ bool Collector::objectReferenceTryCASBarrier(gc* ref, gc** slot, gc* old, gc* va
   return res;
 }
 
+void Collector::objectReferenceBulkCopyBarrier(gc* src, gc** srcSlot, gc* dst, gc** dstSlot, uint32_t count) {
+  // The plan records the whole destination range at once, or stores the
+  // elements through its element barrier if it has no bulk barrier. It lets
+  // us do the copy unless it does it itself.
+  uint32_t bytes = count * sizeof(gc*);
+  if (!JnJVM_org_j3_bindings_Bindings_bulkCopyWriteBarrier__Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Offset_2Lorg_vmmagic_unboxed_ObjectReference_2Lorg_vmmagic_unboxed_Offset_2I(
+        src, (word_t)srcSlot - (word_t)src, dst, (word_t)dstSlot - (word_t)dst, bytes)) {
+    memmove(dstSlot, srcSlot, bytes);
+  }
+  if (vmkit::Thread::get()->doYield) vmkit::Collector::collect();
+}
+
 extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_needsWriteBarrier__() ALWAYS_INLINE;
 extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_needsNonHeapWriteBarrier__() ALWAYS_INLINE;
 
@@ -237,6 +252,12 @@ bool Collector::needsNonHeapWriteBarrier() {
   return JnJVM_org_j3_bindings_Bindings_needsNonHeapWriteBarrier__();
 }
 
+extern "C" uint8_t JnJVM_org_j3_bindings_Bindings_willNeverMove__Lorg_vmmagic_unboxed_ObjectReference_2(gc*) ALWAYS_INLINE;
+
+bool Collector::willNeverMove(gc* object) {
+  return JnJVM_org_j3_bindings_Bindings_willNeverMove__Lorg_vmmagic_unboxed_ObjectReference_2(object);
+}
+
 //TODO: Remove these.
 std::set<gc*> __InternalSet__;
 void* Collector::begOf(gc* obj) {
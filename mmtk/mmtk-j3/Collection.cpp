@@ -29,22 +29,33 @@ extern "C" void Java_org_j3_mmtk_Collection_triggerCollection__I (MMTkObject* C,
   vmkit::MutatorThread* th = vmkit::MutatorThread::get();
   if (why > 2) th->CollectionAttempts++;
 
-  // Verify that another collection is not happening.
-  th->MyVM->rendezvous.startRV();
-  if (th->MyVM->rendezvous.getInitiator() != NULL) {
-    th->MyVM->rendezvous.cancelRV();
-    th->MyVM->rendezvous.join();
-    return;
-  } else {
-    th->MyVM->startCollection();
-    th->MyVM->rendezvous.synchronize();
-
-    JnJVM_org_j3_bindings_Bindings_collect__I(why);
-
-    th->MyVM->rendezvous.finishRV();
-    th->MyVM->endCollection();
+  // Verify that another collection is not happening. A rendezvous that is
+  // not a collection, e.g. a bias revocation, frees no memory: once it is
+  // over, try again.
+  while (true) {
+    th->MyVM->rendezvous.startRV();
+    if (th->MyVM->rendezvous.getInitiator() != NULL) {
+      bool collecting = th->MyVM->rendezvous.isCollecting();
+      th->MyVM->rendezvous.cancelRV();
+      th->MyVM->rendezvous.join();
+      if (collecting) return;
+    } else if (!th->MyVM->rendezvous.waitCriticalSections()) {
+      // Another collection took place while waiting for the JNI critical
+      // sections to end.
+      th->MyVM->rendezvous.cancelRV();
+      return;
+    } else {
+      th->MyVM->rendezvous.markCollection();
+      th->MyVM->startCollection();
+      th->MyVM->rendezvous.synchronize();
+
+      JnJVM_org_j3_bindings_Bindings_collect__I(why);
+
+      th->MyVM->rendezvous.finishRV();
+      th->MyVM->endCollection();
+      return;
+    }
   }
-
 }
 
 extern "C" void Java_org_j3_mmtk_Collection_joinCollection__ (MMTkObject* C) {
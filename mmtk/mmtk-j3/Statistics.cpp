@@ -9,8 +9,7 @@
 
 #include "MMTkObject.h"
 
-#include <sys/time.h>
-#include <ctime>
+#include "vmkit/System.h"
 
 namespace mmtk {
 
@@ -19,19 +18,7 @@ extern "C" int64_t Java_org_j3_mmtk_Statistics_cycles__ (MMTkObject* S) {
 }
 
 extern "C" int64_t Java_org_j3_mmtk_Statistics_nanoTime__ (MMTkObject* S) {
-  int64_t result;
-  struct timeval tp; 
-
-  int res = gettimeofday (&tp, NULL);
-  USE(res);
-  assert(res != -1 && "failed gettimeofday.");
-
-  result = (int64_t) tp.tv_sec;
-  result *= (int64_t)1000000L;
-  result += (int64_t)tp.tv_usec;
-  result *= (int64_t)1000;
-
-  return result;
+  return vmkit::System::GetNanoTime();
 }
 
 
@@ -0,0 +1,138 @@
+public class BiasedLockTest {
+  public static void check(boolean b) throws Exception {
+    if (!b) throw new Exception("Check failed!");
+  }
+
+  static class Counter {
+    int value;
+  }
+
+  // The first lock biases the object towards the main thread, and the
+  // recursive locks only update the count of the bias.
+  static void acquire() throws Exception {
+    Object o = new Object();
+    synchronized (o) {
+      synchronized (o) {
+        synchronized (o) {
+          check(Thread.holdsLock(o));
+        }
+        check(Thread.holdsLock(o));
+      }
+      check(Thread.holdsLock(o));
+    }
+    check(!Thread.holdsLock(o));
+    synchronized (o) {
+      check(Thread.holdsLock(o));
+    }
+  }
+
+  // Another thread locks an object biased towards the main thread, while the
+  // main thread holds it and after it released it.
+  static void revoke() throws Exception {
+    final Counter c = new Counter();
+    synchronized (c) {
+      c.value++;
+    }
+    Thread t = new Thread() {
+      public void run() {
+        for (int i = 0; i < 100000; ++i) {
+          synchronized (c) {
+            c.value++;
+          }
+        }
+      }
+    };
+    t.start();
+    for (int i = 0; i < 100000; ++i) {
+      synchronized (c) {
+        c.value++;
+      }
+    }
+    t.join();
+    check(c.value == 200001);
+
+    // Revoked while held: the main thread keeps the lock.
+    final Object o = new Object();
+    synchronized (o) {
+      Thread h = new Thread() {
+        public void run() {
+          o.hashCode();
+        }
+      };
+      h.start();
+      h.join();
+      check(Thread.holdsLock(o));
+      o.notify();
+    }
+    check(!Thread.holdsLock(o));
+  }
+
+  // Objects whose biases are revoked many times: the later instances are
+  // allocated unbiasable and still lock correctly.
+  static void bulkRevoke() throws Exception {
+    for (int i = 0; i < 50; ++i) {
+      final Counter c = new Counter();
+      synchronized (c) {
+        c.value++;
+      }
+      Thread t = new Thread() {
+        public void run() {
+          synchronized (c) {
+            c.value++;
+          }
+        }
+      };
+      t.start();
+      t.join();
+      check(c.value == 2);
+    }
+  }
+
+  // The locks on objects that do not escape are removed, the locks on the
+  // objects that escape are kept.
+  static int elide() {
+    int sum = 0;
+    for (int i = 0; i < 1000; ++i) {
+      Counter c = new Counter();
+      synchronized (c) {
+        c.value = i;
+      }
+      sum += c.value;
+    }
+    return sum;
+  }
+
+  static volatile Counter shared;
+
+  static void escape() {
+    Counter c = new Counter();
+    shared = c;
+    for (int i = 0; i < 100000; ++i) {
+      synchronized (c) {
+        c.value++;
+      }
+    }
+  }
+
+  public static void main(String[] args) throws Exception {
+    acquire();
+    revoke();
+    bulkRevoke();
+    check(elide() == 499500);
+
+    Thread t = new Thread() {
+      public void run() {
+        while (shared == null) Thread.yield();
+        for (int i = 0; i < 100000; ++i) {
+          synchronized (shared) {
+            shared.value++;
+          }
+        }
+      }
+    };
+    t.start();
+    escape();
+    t.join();
+    check(shared.value == 200000);
+  }
+}
@@ -0,0 +1,202 @@
+// Interface dispatch microbenchmark: call sites seeing 1, 4 and 32
+// implementors of the same interface, and a class implementing enough
+// interfaces for its IMT to have conflicts.
+public class InterfaceDispatchBenchmark {
+  interface Op { int apply(int x); }
+
+  static final class Impl0 implements Op {
+    public int apply(int x) { return x + 0; }
+  }
+  static final class Impl1 implements Op {
+    public int apply(int x) { return x + 1; }
+  }
+  static final class Impl2 implements Op {
+    public int apply(int x) { return x + 2; }
+  }
+  static final class Impl3 implements Op {
+    public int apply(int x) { return x + 3; }
+  }
+  static final class Impl4 implements Op {
+    public int apply(int x) { return x + 4; }
+  }
+  static final class Impl5 implements Op {
+    public int apply(int x) { return x + 5; }
+  }
+  static final class Impl6 implements Op {
+    public int apply(int x) { return x + 6; }
+  }
+  static final class Impl7 implements Op {
+    public int apply(int x) { return x + 7; }
+  }
+  static final class Impl8 implements Op {
+    public int apply(int x) { return x + 8; }
+  }
+  static final class Impl9 implements Op {
+    public int apply(int x) { return x + 9; }
+  }
+  static final class Impl10 implements Op {
+    public int apply(int x) { return x + 10; }
+  }
+  static final class Impl11 implements Op {
+    public int apply(int x) { return x + 11; }
+  }
+  static final class Impl12 implements Op {
+    public int apply(int x) { return x + 12; }
+  }
+  static final class Impl13 implements Op {
+    public int apply(int x) { return x + 13; }
+  }
+  static final class Impl14 implements Op {
+    public int apply(int x) { return x + 14; }
+  }
+  static final class Impl15 implements Op {
+    public int apply(int x) { return x + 15; }
+  }
+  static final class Impl16 implements Op {
+    public int apply(int x) { return x + 16; }
+  }
+  static final class Impl17 implements Op {
+    public int apply(int x) { return x + 17; }
+  }
+  static final class Impl18 implements Op {
+    public int apply(int x) { return x + 18; }
+  }
+  static final class Impl19 implements Op {
+    public int apply(int x) { return x + 19; }
+  }
+  static final class Impl20 implements Op {
+    public int apply(int x) { return x + 20; }
+  }
+  static final class Impl21 implements Op {
+    public int apply(int x) { return x + 21; }
+  }
+  static final class Impl22 implements Op {
+    public int apply(int x) { return x + 22; }
+  }
+  static final class Impl23 implements Op {
+    public int apply(int x) { return x + 23; }
+  }
+  static final class Impl24 implements Op {
+    public int apply(int x) { return x + 24; }
+  }
+  static final class Impl25 implements Op {
+    public int apply(int x) { return x + 25; }
+  }
+  static final class Impl26 implements Op {
+    public int apply(int x) { return x + 26; }
+  }
+  static final class Impl27 implements Op {
+    public int apply(int x) { return x + 27; }
+  }
+  static final class Impl28 implements Op {
+    public int apply(int x) { return x + 28; }
+  }
+  static final class Impl29 implements Op {
+    public int apply(int x) { return x + 29; }
+  }
+  static final class Impl30 implements Op {
+    public int apply(int x) { return x + 30; }
+  }
+  static final class Impl31 implements Op {
+    public int apply(int x) { return x + 31; }
+  }
+
+  interface Wide0 { int wide0(int x); }
+  interface Wide1 { int wide1(int x); }
+  interface Wide2 { int wide2(int x); }
+  interface Wide3 { int wide3(int x); }
+  interface Wide4 { int wide4(int x); }
+  interface Wide5 { int wide5(int x); }
+  interface Wide6 { int wide6(int x); }
+  interface Wide7 { int wide7(int x); }
+  interface Wide8 { int wide8(int x); }
+  interface Wide9 { int wide9(int x); }
+  interface Wide10 { int wide10(int x); }
+  interface Wide11 { int wide11(int x); }
+  interface Wide12 { int wide12(int x); }
+  interface Wide13 { int wide13(int x); }
+  interface Wide14 { int wide14(int x); }
+  interface Wide15 { int wide15(int x); }
+
+  static final class Wide implements Wide0, Wide1, Wide2, Wide3, Wide4, Wide5, Wide6, Wide7, Wide8, Wide9, Wide10, Wide11, Wide12, Wide13, Wide14, Wide15 {
+    public int wide0(int x) { return x ^ 0; }
+    public int wide1(int x) { return x ^ 1; }
+    public int wide2(int x) { return x ^ 2; }
+    public int wide3(int x) { return x ^ 3; }
+    public int wide4(int x) { return x ^ 4; }
+    public int wide5(int x) { return x ^ 5; }
+    public int wide6(int x) { return x ^ 6; }
+    public int wide7(int x) { return x ^ 7; }
+    public int wide8(int x) { return x ^ 8; }
+    public int wide9(int x) { return x ^ 9; }
+    public int wide10(int x) { return x ^ 10; }
+    public int wide11(int x) { return x ^ 11; }
+    public int wide12(int x) { return x ^ 12; }
+    public int wide13(int x) { return x ^ 13; }
+    public int wide14(int x) { return x ^ 14; }
+    public int wide15(int x) { return x ^ 15; }
+  }
+
+  static final int ITERATIONS = 10000000;
+
+  static Op[] makeReceivers(int implementors) {
+    Op[] all = new Op[] {
+      new Impl0(), new Impl1(), new Impl2(), new Impl3(),
+      new Impl4(), new Impl5(), new Impl6(), new Impl7(),
+      new Impl8(), new Impl9(), new Impl10(), new Impl11(),
+      new Impl12(), new Impl13(), new Impl14(), new Impl15(),
+      new Impl16(), new Impl17(), new Impl18(), new Impl19(),
+      new Impl20(), new Impl21(), new Impl22(), new Impl23(),
+      new Impl24(), new Impl25(), new Impl26(), new Impl27(),
+      new Impl28(), new Impl29(), new Impl30(), new Impl31()
+    };
+    Op[] receivers = new Op[64];
+    for (int i = 0; i < receivers.length; i++) {
+      receivers[i] = all[i % implementors];
+    }
+    return receivers;
+  }
+
+  static int dispatch(Op[] receivers) {
+    int result = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+      result = receivers[i & 63].apply(result);
+    }
+    return result;
+  }
+
+  static int dispatchWide(Object o) {
+    Wide0 w0 = (Wide0) o;
+    Wide7 w7 = (Wide7) o;
+    Wide15 w15 = (Wide15) o;
+    int result = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+      result = w15.wide15(w7.wide7(w0.wide0(result)));
+    }
+    return result;
+  }
+
+  static void run(String name, Op[] receivers) {
+    long start = System.currentTimeMillis();
+    int result = dispatch(receivers);
+    long end = System.currentTimeMillis();
+    System.out.println(name + ": " + (end - start) + " ms (" + result + ")");
+  }
+
+  public static void main(String[] args) {
+    int rounds = args.length > 0 ? Integer.parseInt(args[0]) : 3;
+    Op[] one = makeReceivers(1);
+    Op[] four = makeReceivers(4);
+    Op[] thirtyTwo = makeReceivers(32);
+    for (int r = 0; r < rounds; r++) {
+      run("1 implementor", one);
+      run("4 implementors", four);
+      run("32 implementors", thirtyTwo);
+      long start = System.currentTimeMillis();
+      int result = dispatchWide(new Wide());
+      long end = System.currentTimeMillis();
+      System.out.println("16 interfaces: " + (end - start) + " ms (" +
+                         result + ")");
+    }
+  }
+}
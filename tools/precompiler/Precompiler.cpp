@@ -8,6 +8,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Module.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/raw_ostream.h"
@@ -40,10 +42,15 @@ CompiledFrames* frametables[] = {
 };
 
 
+static const char* ProfileFile = NULL;
+
 static void mainCompilerLoaderStart(JavaThread* th) {
   Jnjvm* vm = th->getJVM();
   JnjvmBootstrapLoader* bootstrapLoader = vm->bootstrapLoader;
   JavaAOTCompiler* AOT = new JavaAOTCompiler("AOT");
+  if (ProfileFile != NULL && !AOT->readProfile(ProfileFile)) {
+    fprintf(stderr, "Can't read profile %s\n", ProfileFile);
+  }
   AOT->compileClassLoader(bootstrapLoader);
   AOT->printStats();
   vm->exit(); 
@@ -53,10 +60,16 @@ int main(int argc, char **argv, char **envp) {
   llvm::llvm_shutdown_obj X;
   bool EmitClassBytes = false;
   static const char* EmitClassBytesStr = "-emit-class-bytes";
+  static const char* ProfileStr = "-profile=";
+  static const char* PartitionsStr = "-partitions=";
+  uint32 Partitions = 1;
   for (int i = 0; i < argc; i++) {
     if (!strncmp(argv[i], EmitClassBytesStr, strlen(EmitClassBytesStr))) {
       EmitClassBytes = true;
-      break;
+    } else if (!strncmp(argv[i], ProfileStr, strlen(ProfileStr))) {
+      ProfileFile = &argv[i][strlen(ProfileStr)];
+    } else if (!strncmp(argv[i], PartitionsStr, strlen(PartitionsStr))) {
+      Partitions = atoi(&argv[i][strlen(PartitionsStr)]);
     }
   }
 
@@ -113,6 +126,24 @@ int main(int argc, char **argv, char **envp) {
   
   llvm::WriteBitcodeToFile(AOT->getLLVMModule(), *Out);
 
+  // Also emit the code split in modules that can be compiled in parallel:
+  // generated.0.bc, generated.1.bc, etc.
+  if (Partitions > 1 && !EmitClassBytes) {
+    std::vector<llvm::Module*> parts;
+    AOT->splitModule(Partitions, parts);
+    for (uint32 i = 0; i < parts.size(); ++i) {
+      std::string PartFilename = "generated." + llvm::utostr(i) + ".bc";
+      llvm::raw_fd_ostream PartOut(PartFilename.c_str(), ErrorInfo,
+                                   llvm::raw_fd_ostream::F_Binary);
+      if (!ErrorInfo.empty()) {
+        llvm::errs() << ErrorInfo << '\n';
+        return 1;
+      }
+      llvm::WriteBitcodeToFile(parts[i], PartOut);
+      delete parts[i];
+    }
+  }
+
   return 0;
 }
 
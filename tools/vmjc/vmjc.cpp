@@ -20,6 +20,7 @@
 #include "llvm/LinkAllVMCore.h"
 #include "llvm/Module.h"
 #include "llvm/PassManager.h"
+#include "llvm/ADT/StringExtras.h"
 #include "llvm/Assembly/PrintModulePass.h"
 #include "llvm/CodeGen/LinkAllCodegenComponents.h"
 #include "llvm/Bitcode/ReaderWriter.h"
@@ -100,6 +101,18 @@ PrintStats("print-aot-stats",
            cl::desc("Print stats by the AOT compiler"));
 
 
+static cl::opt<std::string>
+ProfileFile("profile",
+            cl::desc("Profile recorded with -Xrecord-startup, used to tune "
+                     "inlining of hot methods"),
+            cl::value_desc("filename"));
+
+static cl::opt<unsigned>
+Partitions("partitions",
+           cl::desc("Also emit the code split in N modules, to be compiled "
+                    "in parallel"),
+           cl::init(1));
+
 static cl::list<std::string> 
 Properties("D", cl::desc("Set a property"), cl::Prefix, cl::ZeroOrMore);
 
@@ -134,6 +147,10 @@ int main(int argc, char **argv) {
   if (DisableStubs) Comp->generateStubs = false;
   if (AssumeCompiled) Comp->assumeCompiled = true;
   if (DisableCooperativeGC) Comp->disableCooperativeGC();
+  if (!ProfileFile.empty() && !Comp->readProfile(ProfileFile.c_str())) {
+    errs() << "Can't read profile " << ProfileFile << '\n';
+    return 1;
+  }
     
   Jnjvm* vm = new(allocator, "Bootstrap loader") Jnjvm(allocator, NULL, loader);
   
@@ -197,6 +214,27 @@ int main(int argc, char **argv) {
     if (Force || !CheckBitcodeOutputToConsole(*Out, true))
       WriteBitcodeToFile(Comp->getLLVMModule(), *Out);
 
+  if (!DisableOutput && Partitions > 1 && OutputFilename != "-") {
+    std::vector<Module*> parts;
+    Comp->splitModule(Partitions, parts);
+    std::string Stem = OutputFilename;
+    int Len = Stem.length();
+    if (Len > 3 && Stem.compare(Len - 3, 3, ".bc") == 0) {
+      Stem.erase(Len - 3);
+    }
+    for (unsigned i = 0; i < parts.size(); ++i) {
+      std::string PartFilename = Stem + "." + utostr(i) + ".bc";
+      raw_fd_ostream PartOut(PartFilename.c_str(), ErrorInfo,
+                             raw_fd_ostream::F_Binary);
+      if (!ErrorInfo.empty()) {
+        errs() << ErrorInfo << '\n';
+        return 1;
+      }
+      WriteBitcodeToFile(parts[i], PartOut);
+      delete parts[i];
+    }
+  }
+
   return 0;
 }
 